@@ -18,6 +18,30 @@
 #include <map>
 #include <cerrno>
 
+// Copy a segment's file contents into target memory.  Whole host pages of
+// read-only segments are mapped from the file where the target allows, so
+// that they are only read if the target touches them.  The mapping stays
+// live for the whole run, so pages not yet read follow changes to the file,
+// and truncating it makes the host raise SIGBUS when they are touched.
+// Writable segments are always copied, so that the target's data at least
+// is fixed once loaded.
+static void load_segment(memif_t* memif, int fd, const char* buf,
+                         reg_t addr, reg_t offset, reg_t len, bool writable)
+{
+  reg_t pgsize = sysconf(_SC_PAGESIZE);
+  if (!writable && (addr - offset) % pgsize == 0) {
+    reg_t head = -addr % pgsize;
+    reg_t body = len > head ? (len - head) / pgsize * pgsize : 0;
+    if (body && memif->map(addr + head, body, fd, offset + head)) {
+      memif->write(addr, head, buf + offset);
+      memif->write(addr + head + body, len - head - body, buf + offset + head + body);
+      return;
+    }
+  }
+
+  memif->write(addr, len, buf + offset);
+}
+
 std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t* entry,
                                          reg_t load_offset, unsigned required_xlen = 0)
 {
@@ -32,7 +56,6 @@ std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t*
   char* buf = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
   if (buf == MAP_FAILED)
       throw std::invalid_argument(std::string("Specified ELF can't be mapped: ") + strerror(errno));
-  close(fd);
 
   assert(size >= sizeof(Elf64_Ehdr));
   const Elf64_Ehdr* eh64 = (const Elf64_Ehdr*)buf;
@@ -50,7 +73,6 @@ std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t*
     load_offset = 0;
   }
 
-  std::vector<uint8_t> zeros;
   std::map<std::string, uint64_t> symbols;
 
 #define LOAD_ELF(ehdr_t, phdr_t, shdr_t, sym_t, bswap)                         \
@@ -64,12 +86,11 @@ std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t*
         reg_t load_addr = bswap(ph[i].p_paddr) + load_offset;                  \
         if (bswap(ph[i].p_filesz)) {                                           \
           assert(size >= bswap(ph[i].p_offset) + bswap(ph[i].p_filesz));       \
-          memif->write(load_addr, bswap(ph[i].p_filesz),                       \
-                       (uint8_t*)buf + bswap(ph[i].p_offset));                 \
+          load_segment(memif, fd, buf, load_addr, bswap(ph[i].p_offset),       \
+                       bswap(ph[i].p_filesz), bswap(ph[i].p_flags) & PF_W);    \
         }                                                                      \
         if (size_t pad = bswap(ph[i].p_memsz) - bswap(ph[i].p_filesz)) {       \
-          zeros.resize(pad);                                                   \
-          memif->write(load_addr + bswap(ph[i].p_filesz), pad, zeros.data());  \
+          memif->clear(load_addr + bswap(ph[i].p_filesz), pad);                \
         }                                                                      \
       }                                                                        \
     }                                                                          \
@@ -129,6 +150,7 @@ std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t*
   }
 
   munmap(buf, size);
+  close(fd);
 
   return symbols;
 }
@@ -10,6 +10,7 @@
 #include "../riscv/common.h"
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <vector>
 #include <queue>
 #include <iostream>
@@ -19,6 +20,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
 #include <getopt.h>
 #include <libgen.h>
 #include <limits.h>
@@ -53,9 +55,15 @@ static void handle_signal(int sig)
   signal(sig, &handle_signal);
 }
 
+// Delivered to the --async-htif service thread to interrupt a system call
+// it is blocked in on the target's behalf, such as a read of the terminal.
+#define SERVICE_INTERRUPT_SIGNAL SIGUSR1
+static void handle_service_interrupt(int) {}
+
 htif_t::htif_t()
   : mem(this), entry(DRAM_BASE), sig_addr(0), sig_len(0),
     tohost_addr(0), fromhost_addr(0), stopped(false),
+    async(false), service_exiting(false), service_stopped(false),
     syscall_proxy(this)
 {
   signal(SIGINT, &handle_signal);
@@ -166,6 +174,17 @@ std::map<std::string, uint64_t> htif_t::load_payload(const std::string& payload,
         memif_t::write(taddr, len, src);
     }
 
+    void clear(addr_t taddr, size_t len) override
+    {
+      if (!htif->is_address_preloaded(taddr, len))
+        memif_t::clear(taddr, len);
+    }
+
+    bool map(addr_t taddr, size_t len, int fd, off_t offset) override
+    {
+      return htif->is_address_preloaded(taddr, len) || memif_t::map(taddr, len, fd, offset);
+    }
+
    private:
     htif_t* htif;
   } preload_aware_memif(this);
@@ -185,6 +204,8 @@ void htif_t::load_symbols(std::map<std::string, uint64_t>& symbols)
     nop_memif_t(htif_t* htif) : memif_t(htif) {}
     void read(addr_t UNUSED addr, size_t UNUSED len, void UNUSED *bytes) override {}
     void write(addr_t UNUSED taddr, size_t UNUSED len, const void UNUSED *src) override {}
+    void clear(addr_t UNUSED taddr, size_t UNUSED len) override {}
+    bool map(addr_t UNUSED taddr, size_t UNUSED len, int UNUSED fd, off_t UNUSED offset) override { return true; }
   } nop_memif(this);
 
   reg_t nop_entry;
@@ -239,10 +260,12 @@ const char* htif_t::get_symbol(uint64_t addr)
 }
 
 bool htif_t::should_exit() const {
+  std::lock_guard<std::mutex> lock(exit_lock);
   return signal_exit || exitcode.has_value();
 }
 
 void htif_t::htif_exit(int exit_code) {
+  std::lock_guard<std::mutex> lock(exit_lock);
   exitcode = exit_code;
 }
 
@@ -295,8 +318,24 @@ int htif_t::run()
       idle();
   }
 
+  if (async) {
+    // Without SA_RESTART, so that the signal makes blocking calls fail with
+    // EINTR rather than resume.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &handle_service_interrupt;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SERVICE_INTERRUPT_SIGNAL, &sa, NULL);
+    service_thread = std::thread(&htif_t::service_main, this);
+  }
+
   while (!should_exit())
   {
+    if (async) {
+      service_async();
+      continue;
+    }
+
     uint64_t tohost;
 
     try {
@@ -331,11 +370,87 @@ int htif_t::run()
     }
   }
 
+  if (service_thread.joinable()) {
+    // The service thread may be blocked in the host on a request that will
+    // now never be answered, so keep interrupting it until it has left its
+    // loop; a signal that arrives just before it blocks would be lost.
+    service_exiting.store(true, std::memory_order_release);
+    while (!service_stopped.load(std::memory_order_acquire)) {
+      pthread_kill(service_thread.native_handle(), SERVICE_INTERRUPT_SIGNAL);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    service_thread.join();
+  }
+
   stop();
 
   return exit_code();
 }
 
+// The main-thread half of --async-htif: pass tohost on and fromhost back,
+// one of each per quantum, as run() does.  A request is left in tohost
+// while the mailbox is full, so the target waits rather than losing it.
+void htif_t::service_async()
+{
+  try {
+    uint64_t tohost;
+    if (!requests.full() && (tohost = from_target(mem.read_uint64(tohost_addr))) != 0) {
+      mem.write_uint64(tohost_addr, target_endian<uint64_t>::zero);
+      requests.push(tohost);
+    }
+  } catch (mem_trap_t& t) {
+    bad_address("accessing tohost", t.get_tval());
+  }
+
+  idle();
+
+  try {
+    uint64_t fromhost;
+    if (responses.peek(fromhost) && !mem.read_uint64(fromhost_addr)) {
+      mem.write_uint64(fromhost_addr, to_target(fromhost));
+      responses.pop(fromhost);
+    }
+  } catch (mem_trap_t& t) {
+    bad_address("accessing fromhost", t.get_tval());
+  }
+}
+
+void htif_t::service_main()
+{
+  std::function<void(reg_t)> fromhost_callback = [this](uint64_t x) {
+    while (!responses.push(x) && !service_exiting.load(std::memory_order_acquire))
+      std::this_thread::yield();
+  };
+
+  // Requests come in bursts; between them, back off to sleeping so as not
+  // to take the host CPU from the harts.
+  const size_t spins_before_sleep = 1000;
+  size_t spins = 0;
+
+  while (!service_exiting.load(std::memory_order_acquire)) {
+    uint64_t tohost;
+    if (requests.pop(tohost)) {
+      try {
+        command_t cmd(mem, tohost, fromhost_callback);
+        device_list.handle_command(cmd);
+      } catch (mem_trap_t& t) {
+        std::stringstream tohost_hex;
+        tohost_hex << std::hex << tohost;
+        bad_address("host was accessing memory on behalf of target (tohost = 0x" + tohost_hex.str() + ")", t.get_tval());
+      }
+      spins = 0;
+    } else if (++spins < spins_before_sleep) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    device_list.tick();
+  }
+
+  service_stopped.store(true, std::memory_order_release);
+}
+
 bool htif_t::done()
 {
   return stopped;
@@ -343,6 +458,7 @@ bool htif_t::done()
 
 int htif_t::exit_code()
 {
+  std::lock_guard<std::mutex> lock(exit_lock);
   return exitcode.value_or(0) >> 1;
 }
 
@@ -386,6 +502,9 @@ void htif_t::parse_arguments(int argc, char ** argv)
       case HTIF_LONG_OPTIONS_OPTIND + 7:
         symbol_elfs.push_back(optarg);
         break;
+      case HTIF_LONG_OPTIONS_OPTIND + 8:
+        async = true;
+        break;
       case '?':
         if (!opterr)
           break;
@@ -432,6 +551,10 @@ void htif_t::parse_arguments(int argc, char ** argv)
           c = HTIF_LONG_OPTIONS_OPTIND + 7;
           optarg = optarg + 12;
         }
+        else if (arg == "+async-htif") {
+          c = HTIF_LONG_OPTIONS_OPTIND + 8;
+          optarg = nullptr;
+        }
         else if (arg.find("+permissive-off") == 0) {
           if (opterr)
             throw std::invalid_argument("Found +permissive-off when not parsing permissively");
@@ -7,9 +7,13 @@
 #include "syscall.h"
 #include "device.h"
 #include "byteorder.h"
+#include "mailbox.h"
 #include "../riscv/platform.h"
 #include <string.h>
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <assert.h>
 
@@ -52,6 +56,11 @@ class htif_t : public chunked_memif_t
   addr_t get_tohost_addr() { return tohost_addr; }
   addr_t get_fromhost_addr() { return fromhost_addr; }
 
+  // Return true if target requests are serviced on their own host thread,
+  // which then reaches target memory through this chunked_memif_t
+  // concurrently with idle().
+  bool is_async() const { return async; }
+
  protected:
   virtual void reset() = 0;
 
@@ -88,6 +97,8 @@ class htif_t : public chunked_memif_t
   void parse_arguments(int argc, char ** argv);
   void register_devices();
   void usage(const char * program_name);
+  void service_async();
+  void service_main();
   unsigned int expected_xlen = 0;
   const reg_t load_offset = DRAM_BASE;
   memif_t mem;
@@ -103,8 +114,19 @@ class htif_t : public chunked_memif_t
   addr_t fromhost_addr;
   // Set to a value by htif_exit() when the simulation should exit.
   std::optional<int> exitcode;
+  mutable std::mutex exit_lock;
   bool stopped;
 
+  // With --async-htif, run() moves requests from tohost into the requests
+  // mailbox and service_thread hands them to device_list, whose responses
+  // come back through the responses mailbox to be written to fromhost.
+  bool async;
+  std::thread service_thread;
+  std::atomic<bool> service_exiting;
+  std::atomic<bool> service_stopped;
+  mailbox_t<uint64_t, 256> requests;
+  mailbox_t<uint64_t, 256> responses;
+
   device_list_t device_list;
   syscall_t syscall_proxy;
   bcd_t bcd;
@@ -142,6 +164,8 @@ class htif_t : public chunked_memif_t
        +payload=PATH\n\
       --symbol-elf=PATH    Populate the symbol table with the ELF file at PATH\n\
        +symbol-elf=PATH\n\
+      --async-htif         Service system calls and the console on a separate\n\
+       +async-htif           host thread while the target keeps running\n\
 \n\
 HOST OPTIONS (currently unsupported)\n\
       --disk=DISK          Add DISK device. Use a ramdisk since this isn't\n\
@@ -162,6 +186,7 @@ TARGET (RISC-V BINARY) OPTIONS\n\
 {"signature-granularity",    required_argument, 0, HTIF_LONG_OPTIONS_OPTIND + 5 },     \
 {"target-argument",          required_argument, 0, HTIF_LONG_OPTIONS_OPTIND + 6 },     \
 {"symbol-elf",               required_argument, 0, HTIF_LONG_OPTIONS_OPTIND + 7 },     \
+{"async-htif",               no_argument,       0, HTIF_LONG_OPTIONS_OPTIND + 8 },     \
 {0, 0, 0, 0}
 
 #endif // __HTIF_H
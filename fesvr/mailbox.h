@@ -0,0 +1,59 @@
+// See LICENSE for license details.
+
+#ifndef __MAILBOX_H
+#define __MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+
+// A queue of up to N values between one producer thread and one consumer
+// thread.  Each index is only written by one side, so no locks are needed.
+template<typename T, size_t N>
+class mailbox_t
+{
+  static_assert(N && (N & (N - 1)) == 0, "N must be a power of 2");
+
+ public:
+  mailbox_t() : head(0), tail(0) {}
+
+  // producer side
+  bool full() const
+  {
+    return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == N;
+  }
+
+  bool push(const T& x)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N)
+      return false;
+    buf[t % N] = x;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool peek(T& x) const
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    x = buf[h % N];
+    return true;
+  }
+
+  bool pop(T& x)
+  {
+    if (!peek(x))
+      return false;
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T buf[N];
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+};
+
+#endif
@@ -84,6 +84,51 @@ void memif_t::write(addr_t addr, size_t len, const void* bytes)
   }
 }
 
+void memif_t::clear(addr_t addr, size_t len)
+{
+  // only the unaligned ends need a buffer of zeros
+  size_t align = cmemif->chunk_align();
+  std::vector<uint8_t> zeros(align);
+
+  size_t head = std::min(len, size_t(-addr & (align-1)));
+  write(addr, head, zeros.data());
+  addr += head;
+  len -= head;
+
+  size_t tail = len & (align-1);
+  if (len != tail)
+    cmemif->clear_chunk(addr, len - tail);
+  write(addr + len - tail, tail, zeros.data());
+}
+
+bool memif_t::map(addr_t addr, size_t len, int fd, off_t offset)
+{
+  return cmemif->map_chunk(addr, len, fd, offset);
+}
+
+bool memif_t::host_iov(addr_t addr, size_t len, std::vector<struct iovec>& iov)
+{
+  const size_t pgsize = 4096;
+  if (addr + len < addr)
+    return false;
+
+  while (len > 0) {
+    char* host_addr = cmemif->chunk_host_addr(addr);
+    if (!host_addr)
+      return false;
+
+    size_t n = std::min(len, pgsize - size_t(addr % pgsize));
+    if (!iov.empty() && (char*)iov.back().iov_base + iov.back().iov_len == host_addr)
+      iov.back().iov_len += n;
+    else
+      iov.push_back({host_addr, n});
+    addr += n;
+    len -= n;
+  }
+
+  return true;
+}
+
 #define MEMIF_READ_FUNC \
   if(addr & (sizeof(val)-1)) \
     throw std::runtime_error("misaligned address"); \
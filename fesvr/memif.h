@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdexcept>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include "byteorder.h"
 #include "../riscv/cfg.h"
 
@@ -19,6 +22,13 @@ public:
   virtual void read_chunk(addr_t taddr, size_t len, void* dst) = 0;
   virtual void write_chunk(addr_t taddr, size_t len, const void* src) = 0;
   virtual void clear_chunk(addr_t taddr, size_t len) = 0;
+  // Map len bytes of fd from offset into target memory at taddr, copy-on-
+  // write, and return true, or return false if the target cannot.  All
+  // three are multiples of the host page size.
+  virtual bool map_chunk(addr_t, size_t, int, off_t) { return false; }
+  // Return a host pointer to taddr, valid to the end of its 4 KiB page, if
+  // the host can access target memory there directly; otherwise nullptr.
+  virtual char* chunk_host_addr(addr_t) { return nullptr; }
 
   virtual size_t chunk_align() = 0;
   virtual size_t chunk_max_size() = 0;
@@ -39,6 +49,13 @@ public:
   // read and write byte arrays
   virtual void read(addr_t addr, size_t len, void* bytes);
   virtual void write(addr_t addr, size_t len, const void* bytes);
+  virtual void clear(addr_t addr, size_t len);
+  // map part of a file into target memory, as chunked_memif_t::map_chunk()
+  virtual bool map(addr_t addr, size_t len, int fd, off_t offset);
+
+  // Append the host buffers backing [addr, addr + len) to iov and return
+  // true, or return false if not all of it can be accessed directly.
+  virtual bool host_iov(addr_t addr, size_t len, std::vector<struct iovec>& iov);
 
   // read and write 8-bit words
   virtual target_endian<uint8_t> read_uint8(addr_t addr);
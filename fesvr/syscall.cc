@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <limits.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -163,6 +164,8 @@ syscall_t::syscall_t(htif_t* htif)
   table[62] = &syscall_t::sys_lseek;
   table[63] = &syscall_t::sys_read;
   table[64] = &syscall_t::sys_write;
+  table[65] = &syscall_t::sys_readv;
+  table[66] = &syscall_t::sys_writev;
   table[67] = &syscall_t::sys_pread;
   table[68] = &syscall_t::sys_pwrite;
   table[78] = &syscall_t::sys_readlinkat;
@@ -212,7 +215,7 @@ void syscall_t::handle_syscall(command_t cmd)
 {
   if (cmd.payload() & 1) // test pass/fail
   {
-    htif->exitcode = cmd.payload();
+    htif->htif_exit(cmd.payload());
     if (htif->exit_code())
       std::cerr << "*** FAILED *** (tohost = " << htif->exit_code() << ")" << std::endl;
     return;
@@ -234,40 +237,127 @@ static reg_t sysret_errno(sreg_t ret)
   return ret == -1 ? -errno : ret;
 }
 
+// Do I/O between a file and buffers in target memory, straight into or out
+// of the host memory behind them if possible, else through a bounce buffer.
+// to_target is true for I/O that reads from the file.
+ssize_t syscall_t::target_io(const std::vector<target_buf_t>& bufs, bool to_target, io_func_t io)
+{
+  std::vector<struct iovec> iov;
+  bool direct = true;
+  for (auto& b : bufs)
+    direct = direct && memif->host_iov(b.addr, b.len, iov);
+  if (direct && iov.size() <= IOV_MAX)
+    return io(iov.data(), iov.size());
+
+  size_t total = 0;
+  for (auto& b : bufs)
+    total += b.len;
+  std::vector<char> buf(total);
+
+  if (!to_target) {
+    size_t pos = 0;
+    for (auto& b : bufs) {
+      memif->read(b.addr, b.len, buf.data() + pos);
+      pos += b.len;
+    }
+  }
+
+  struct iovec bounce = {buf.data(), total};
+  ssize_t ret = io(&bounce, 1);
+
+  if (to_target && ret > 0) {
+    size_t pos = 0;
+    for (auto& b : bufs) {
+      size_t n = std::min<size_t>(b.len, ret - pos);
+      memif->write(b.addr, n, buf.data() + pos);
+      pos += n;
+    }
+  }
+
+  return ret;
+}
+
+// Read an array of iovcnt struct iovecs from the target into bufs, checking
+// it as readv() and writev() would; returns 0 or a negated errno.
+reg_t syscall_t::read_target_iov(reg_t piov, reg_t iovcnt, std::vector<target_buf_t>& bufs)
+{
+  if (iovcnt > IOV_MAX)
+    return -EINVAL;
+
+  bool rv32 = htif->expected_xlen == 32;
+  reg_t total = 0;
+  for (reg_t i = 0; i < iovcnt; i++) {
+    target_buf_t b;
+    if (rv32) {
+      b.addr = htif->from_target(memif->read_uint32(piov + i * 8));
+      b.len = htif->from_target(memif->read_uint32(piov + i * 8 + 4));
+    } else {
+      b.addr = htif->from_target(memif->read_uint64(piov + i * 16));
+      b.len = htif->from_target(memif->read_uint64(piov + i * 16 + 8));
+    }
+    total += b.len;
+    if (b.len > SSIZE_MAX || total > SSIZE_MAX)
+      return -EINVAL;
+    bufs.push_back(b);
+  }
+
+  return 0;
+}
+
 reg_t syscall_t::sys_read(reg_t fd, reg_t pbuf, reg_t len, reg_t a3, reg_t a4, reg_t a5, reg_t a6)
 {
-  std::vector<char> buf(len);
-  ssize_t ret = read(fds.lookup(fd), buf.data(), len);
-  reg_t ret_errno = sysret_errno(ret);
-  if (ret > 0)
-    memif->write(pbuf, ret, buf.data());
-  return ret_errno;
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io({{pbuf, len}}, true, [=](const struct iovec* iov, int n) {
+    return readv(host_fd, iov, n);
+  }));
 }
 
 reg_t syscall_t::sys_pread(reg_t fd, reg_t pbuf, reg_t len, reg_t off, reg_t a4, reg_t a5, reg_t a6)
 {
-  std::vector<char> buf(len);
-  ssize_t ret = pread(fds.lookup(fd), buf.data(), len, off);
-  reg_t ret_errno = sysret_errno(ret);
-  if (ret > 0)
-    memif->write(pbuf, ret, buf.data());
-  return ret_errno;
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io({{pbuf, len}}, true, [=](const struct iovec* iov, int n) {
+    return preadv(host_fd, iov, n, off);
+  }));
 }
 
 reg_t syscall_t::sys_write(reg_t fd, reg_t pbuf, reg_t len, reg_t a3, reg_t a4, reg_t a5, reg_t a6)
 {
-  std::vector<char> buf(len);
-  memif->read(pbuf, len, buf.data());
-  reg_t ret = sysret_errno(write(fds.lookup(fd), buf.data(), len));
-  return ret;
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io({{pbuf, len}}, false, [=](const struct iovec* iov, int n) {
+    return writev(host_fd, iov, n);
+  }));
 }
 
 reg_t syscall_t::sys_pwrite(reg_t fd, reg_t pbuf, reg_t len, reg_t off, reg_t a4, reg_t a5, reg_t a6)
 {
-  std::vector<char> buf(len);
-  memif->read(pbuf, len, buf.data());
-  reg_t ret = sysret_errno(pwrite(fds.lookup(fd), buf.data(), len, off));
-  return ret;
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io({{pbuf, len}}, false, [=](const struct iovec* iov, int n) {
+    return pwritev(host_fd, iov, n, off);
+  }));
+}
+
+reg_t syscall_t::sys_readv(reg_t fd, reg_t piov, reg_t iovcnt, reg_t a3, reg_t a4, reg_t a5, reg_t a6)
+{
+  std::vector<target_buf_t> bufs;
+  if (reg_t err = read_target_iov(piov, iovcnt, bufs))
+    return err;
+
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io(bufs, true, [=](const struct iovec* iov, int n) {
+    return readv(host_fd, iov, n);
+  }));
+}
+
+reg_t syscall_t::sys_writev(reg_t fd, reg_t piov, reg_t iovcnt, reg_t a3, reg_t a4, reg_t a5, reg_t a6)
+{
+  std::vector<target_buf_t> bufs;
+  if (reg_t err = read_target_iov(piov, iovcnt, bufs))
+    return err;
+
+  int host_fd = fds.lookup(fd);
+  return sysret_errno(target_io(bufs, false, [=](const struct iovec* iov, int n) {
+    return writev(host_fd, iov, n);
+  }));
 }
 
 reg_t syscall_t::sys_close(reg_t fd, reg_t a1, reg_t a2, reg_t a3, reg_t a4, reg_t a5, reg_t a6)
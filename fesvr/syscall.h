@@ -5,6 +5,7 @@
 
 #include "device.h"
 #include "memif.h"
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -44,6 +45,15 @@ class syscall_t : public device_t
   void handle_syscall(command_t cmd);
   void dispatch(addr_t mm);
 
+  // A buffer in target memory, as named by an iovec from the target.
+  struct target_buf_t {
+    reg_t addr;
+    reg_t len;
+  };
+  typedef std::function<ssize_t(const struct iovec*, int)> io_func_t;
+  ssize_t target_io(const std::vector<target_buf_t>& bufs, bool to_target, io_func_t io);
+  reg_t read_target_iov(reg_t piov, reg_t iovcnt, std::vector<target_buf_t>& bufs);
+
   std::string chroot;
   std::string do_chroot(const char* fn);
   std::string undo_chroot(const char* fn);
@@ -54,6 +64,8 @@ class syscall_t : public device_t
   reg_t sys_pread(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
   reg_t sys_write(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
   reg_t sys_pwrite(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
+  reg_t sys_readv(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
+  reg_t sys_writev(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
   reg_t sys_close(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
   reg_t sys_lseek(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
   reg_t sys_fstat(reg_t, reg_t, reg_t, reg_t, reg_t, reg_t, reg_t);
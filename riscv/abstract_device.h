@@ -5,6 +5,7 @@
 #include "common.h"
 #include <cstdint>
 #include <cstddef>
+#include <iosfwd>
 #include <string>
 #include <map>
 #include <stdexcept>
@@ -19,6 +20,17 @@ class abstract_device_t {
   virtual reg_t size() = 0;
   virtual ~abstract_device_t() {}
   virtual void tick(reg_t UNUSED rtc_ticks) {}
+  // The number of RTC ticks until this device next changes state by itself,
+  // e.g. raises a timer interrupt, or UINT64_MAX if nothing is scheduled.
+  // The simulator ends its quantum at the earliest such event, so that
+  // tick() sees it on time rather than at the end of a whole quantum.
+  virtual reg_t next_event() { return UINT64_MAX; }
+
+  // Checkpointing: devices with software-visible state write it out in
+  // save() and read it back, in the same order, in restore().  See
+  // checkpoint.h for helpers.
+  virtual void save(std::ostream& UNUSED o) {}
+  virtual void restore(std::istream& UNUSED i) {}
 };
 
 // factory for devices which should show up in the DTS, and can be
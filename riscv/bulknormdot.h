@@ -1,6 +1,8 @@
 #ifndef _RISCV_BULKNORMDOT_H
 #define _RISCV_BULKNORMDOT_H
 
+#include <algorithm>
+#include <climits>
 #include <cstdint>
 #include <vector>
 #include "softfloat.h"
@@ -168,6 +170,72 @@ class ofp8_e4m3 final : public IEEEFloatFormat<uint8_t, uint8_t, uint8_t, 4, 3>
   }
 };
 
+/** round the accumulated products of a bulk-normalization dot product to binary32 */
+static inline bulk_norm_out_t bulk_norm_round(const DotConfig cfg, int64_t acc, int max_approx_prod_exp,
+                                              bool any_pos_inf, bool any_neg_inf, bool any_nan,
+                                              bool any_invalid_nan, bool any_sigNan)
+{
+  bool acc_sign = false; // assuming the accumulator is positive
+
+  // normalize result to f32
+  bool sign = (acc < 0) != acc_sign;
+  uint64_t mag = acc < 0 ? -acc : acc; // absolute magnitude
+  int norm_dist = int_log2(mag);
+  int exp = max_approx_prod_exp - f32_mant_bits - cfg.guardBits + norm_dist;
+
+  // fixing normalization distance for subnormal results
+  int sig_bits = (!cfg.flushSub && exp <= 0) ? f32_mant_bits - (1-exp) : f32_mant_bits;
+  sig_bits = std::max(sig_bits, 0);
+  uint32_t rounded_sig = shift_right_jam(uint64_t(mag) << sig_bits, norm_dist);
+
+  bool any_inf      = any_pos_inf || any_neg_inf;
+  bool overflow     = (exp >= f32_exp_mask && mag != 0) || any_inf;
+  bool op_sign_inf  = (any_pos_inf && any_neg_inf);
+  bool nan_out      = any_nan || op_sign_inf;
+  bool overflowflag = (exp >= f32_exp_mask && mag != 0) && !any_inf && !nan_out;
+
+  if (nan_out) {
+    sign = 0;
+    exp = f32_exp_mask;
+    rounded_sig = uint32_t(1) << (f32_mant_bits - 1);
+  } else if (overflow) {
+    exp = f32_exp_mask;
+    rounded_sig = 0;
+    if (any_inf)
+      sign = any_neg_inf;
+  } else if (mag == 0) {
+    // exact zero result
+    exp = 0;
+  } else if (exp <= 0) {
+    if (cfg.flushSub) {
+      // flush output subnormals
+      exp = 0;
+      rounded_sig = 0;
+    } else {
+      exp = 0;
+      // rounded_sig should have been properly denormalized previously
+    }
+  }
+
+  bulk_norm_out_t  su;
+  su.flags = 0;
+  su.out = (rounded_sig & f32_mant_mask)
+         | (exp << f32_mant_bits)
+         | (uint32_t(sign) << (f32_exp_bits + f32_mant_bits));
+
+  if (any_sigNan) {
+    su.flags |= softfloat_flag_invalid;
+  }
+  if  (any_invalid_nan || op_sign_inf) {
+    su.flags |= softfloat_flag_invalid;
+  }
+  if  (overflowflag) {
+    su.flags |= softfloat_flag_overflow;
+  }
+
+  return su;
+}
+
 /** bulk-normalization dot product (without accumulation) with binary32 result
  *
  * The actual products of significands is provided as an argument such that the model can be used
@@ -244,63 +312,8 @@ template<typename ValueTypeLHS, typename ValueTypeRHS, typename SigProdType> bul
       (prod_sign != acc_sign ? -shifted_sig : shifted_sig);
   }
 
-  // normalize result to f32
-  bool sign = (acc < 0) != acc_sign;
-  uint64_t mag = acc < 0 ? -acc : acc; // absolute magnitude
-  int norm_dist = int_log2(mag);
-  int exp = max_approx_prod_exp - f32_mant_bits - cfg.guardBits + norm_dist;
-
-  // fixing normalization distance for subnormal results
-  int sig_bits = (!cfg.flushSub && exp <= 0) ? f32_mant_bits - (1-exp) : f32_mant_bits;
-  sig_bits = std::max(sig_bits, 0);
-  uint32_t rounded_sig = shift_right_jam(uint64_t(mag) << sig_bits, norm_dist);
-
-  bool any_inf      = any_pos_inf || any_neg_inf;
-  bool overflow     = (exp >= f32_exp_mask && mag != 0) || any_inf;
-  bool op_sign_inf  = (any_pos_inf && any_neg_inf);
-  bool nan_out      = any_nan || op_sign_inf;
-  bool overflowflag = (exp >= f32_exp_mask && mag != 0) && !any_inf && !nan_out;
-
-  if (nan_out) {
-    sign = 0;
-    exp = f32_exp_mask;
-    rounded_sig = uint32_t(1) << (f32_mant_bits - 1);
-  } else if (overflow) {
-    exp = f32_exp_mask;
-    rounded_sig = 0;
-    if (any_inf)
-      sign = any_neg_inf;
-  } else if (mag == 0) {
-    // exact zero result
-    exp = 0;
-  } else if (exp <= 0) {
-    if (cfg.flushSub) {
-      // flush output subnormals
-      exp = 0;
-      rounded_sig = 0;
-    } else {
-      exp = 0;
-      // rounded_sig should have been properly denormalized previously
-    }
-  }
-
-  bulk_norm_out_t  su;
-  su.flags = 0;
-  su.out = (rounded_sig & f32_mant_mask)
-         | (exp << f32_mant_bits)
-         | (uint32_t(sign) << (f32_exp_bits + f32_mant_bits));
-
-  if (any_sigNan) {
-    su.flags |= softfloat_flag_invalid;
-  }
-  if  (any_invalid_nan || op_sign_inf) {
-    su.flags |= softfloat_flag_invalid;
-  }
-  if  (overflowflag) {
-    su.flags |= softfloat_flag_overflow;
-  }
-
-  return su;
+  return bulk_norm_round(cfg, acc, max_approx_prod_exp, any_pos_inf, any_neg_inf, any_nan,
+                         any_invalid_nan, any_sigNan);
 }
 
 /** bf16_t dot product (without accumulation) */
@@ -330,4 +343,125 @@ bulk_norm_out_t bulk_norm_dot_ofp8(const DotConfig cfg, const L* a, const R* b)
   return bulk_norm_dot_no_mult<L, R, uint16_t>(cfg, a, b, &prod_sigs[0]);
 }
 
+/** encoding parameters of the formats accepted by bulk_norm_dot() */
+template<typename T> struct bulk_norm_format;
+
+template<> struct bulk_norm_format<bf16_t> {
+  typedef uint16_t bits_t;
+  static const int exp_bits = 8;
+  static const int mant_bits = 7;
+  static bool inf(unsigned exp, unsigned mant) { return exp == 0xff && mant == 0; }
+  static bool nan(unsigned exp, unsigned mant) { return exp == 0xff && mant != 0; }
+  static bool sigNan(unsigned exp, unsigned mant) { return nan(exp, mant) && (mant >> 6) == 0; }
+};
+
+template<> struct bulk_norm_format<ofp8_e5m2> {
+  typedef uint8_t bits_t;
+  static const int exp_bits = 5;
+  static const int mant_bits = 2;
+  static bool inf(unsigned exp, unsigned mant) { return exp == 0x1f && mant == 0; }
+  static bool nan(unsigned exp, unsigned mant) { return exp == 0x1f && mant != 0; }
+  static bool sigNan(unsigned, unsigned) { return false; }
+};
+
+template<> struct bulk_norm_format<ofp8_e4m3> {
+  typedef uint8_t bits_t;
+  static const int exp_bits = 4;
+  static const int mant_bits = 3;
+  static bool inf(unsigned, unsigned) { return false; }
+  static bool nan(unsigned exp, unsigned mant) { return exp == 0xf && mant == 0x7; }
+  static bool sigNan(unsigned, unsigned) { return false; }
+};
+
+/** bulk-normalization dot product (without accumulation) with binary32 result
+ *
+ * Computes the same result as bulk_norm_dot_no_mult() directly from the
+ * encodings, without temporary arrays.  The first pass finds the largest
+ * product exponent and the special cases, the second one accumulates; both
+ * are branch-free so that the compiler can vectorize them.
+ *
+ * @param cfg dot-product configuration
+ * @param a left-hand-side operand encodings
+ * @param b right-hand-side operand encodings
+ *
+ */
+template<typename L, typename R>
+bulk_norm_out_t bulk_norm_dot(const DotConfig cfg,
+                              const typename bulk_norm_format<L>::bits_t* a,
+                              const typename bulk_norm_format<R>::bits_t* b)
+{
+  typedef bulk_norm_format<L> LF;
+  typedef bulk_norm_format<R> RF;
+  const int lhs_bias = (1 << (LF::exp_bits - 1)) - 1;
+  const int rhs_bias = (1 << (RF::exp_bits - 1)) - 1;
+  const int exp_offset = f32_exp_bias - (lhs_bias + rhs_bias);
+
+  auto lhs_exp = [](unsigned x) { return (x >> LF::mant_bits) & ((1 << LF::exp_bits) - 1); };
+  auto lhs_mant = [](unsigned x) { return x & ((1 << LF::mant_bits) - 1); };
+  auto rhs_exp = [](unsigned x) { return (x >> RF::mant_bits) & ((1 << RF::exp_bits) - 1); };
+  auto rhs_mant = [](unsigned x) { return x & ((1 << RF::mant_bits) - 1); };
+  auto prod_sign = [](unsigned x, unsigned y) {
+    return ((x >> (LF::exp_bits + LF::mant_bits)) ^ (y >> (RF::exp_bits + RF::mant_bits))) & 1;
+  };
+
+  // A product's exponent; flushed products get exponent 0 and contribute
+  // nothing.
+  const bool flush_sub = cfg.flushSub;
+  auto prod_exp = [=](unsigned ex, unsigned mx, unsigned ey, unsigned my, bool& flushed) {
+    flushed = flush_sub & ((ex == 0) | (ey == 0));
+    bool zero = ((ex == 0) & (mx == 0)) | ((ey == 0) & (my == 0));
+    int exp = int(ex + (ex == 0)) + int(ey + (ey == 0)) + exp_offset;
+    exp = zero ? exp_offset : exp;
+    return flushed ? 0 : exp;
+  };
+
+  unsigned any_pos_inf     = 0;
+  unsigned any_neg_inf     = 0;
+  unsigned any_nan         = 0;
+  unsigned any_invalid_nan = 0;
+  unsigned any_sigNan      = 0;
+  int max_approx_prod_exp = INT_MIN;
+
+  for (int i = 0; i < cfg.n; i++) {
+    unsigned ex = lhs_exp(a[i]), mx = lhs_mant(a[i]);
+    unsigned ey = rhs_exp(b[i]), my = rhs_mant(b[i]);
+    bool flushed;
+    max_approx_prod_exp = std::max(max_approx_prod_exp, prod_exp(ex, mx, ey, my, flushed));
+
+    bool a_is_zero = (ex == 0) & (flush_sub | (mx == 0));
+    bool b_is_zero = (ey == 0) & (flush_sub | (my == 0));
+    bool a_inf = LF::inf(ex, mx), b_inf = RF::inf(ey, my);
+    bool either_nan = LF::nan(ex, mx) | RF::nan(ey, my);
+    bool finite_inf = (a_inf | b_inf) & !either_nan & !(a_is_zero | b_is_zero);
+    unsigned sign = prod_sign(a[i], b[i]);
+    any_pos_inf |= finite_inf & !sign;
+    any_neg_inf |= finite_inf & sign;
+    any_invalid_nan |= (a_inf & b_is_zero) | (b_inf & a_is_zero);
+    any_nan |= either_nan;
+    any_sigNan |= LF::sigNan(ex, mx) | RF::sigNan(ey, my);
+  }
+
+  // The aligned products are below 2^63, so clamping the shift amounts to
+  // 63 keeps shift_right_jam()'s result without its range checks.
+  const int prod_shift = f32_mant_bits - LF::mant_bits - RF::mant_bits + cfg.guardBits;
+  int64_t acc = 0;
+
+  for (int i = 0; i < cfg.n; i++) {
+    unsigned ex = lhs_exp(a[i]), mx = lhs_mant(a[i]);
+    unsigned ey = rhs_exp(b[i]), my = rhs_mant(b[i]);
+    uint64_t sig_a = mx | (unsigned(ex != 0) << LF::mant_bits);
+    uint64_t sig_b = my | (unsigned(ey != 0) << RF::mant_bits);
+    uint64_t prod_sig = uint64_t(uint16_t(sig_a * sig_b)) << prod_shift;
+    bool flushed;
+    int shift = std::min(max_approx_prod_exp - prod_exp(ex, mx, ey, my, flushed), 63);
+    uint64_t shifted_sig = prod_sig >> shift;
+    shifted_sig |= (shifted_sig << shift) != prod_sig;
+    uint64_t negate = -uint64_t(prod_sign(a[i], b[i]));
+    acc += ((shifted_sig ^ negate) - negate) & -uint64_t(!flushed);
+  }
+
+  return bulk_norm_round(cfg, acc, max_approx_prod_exp, any_pos_inf, any_neg_inf,
+                         any_nan | any_invalid_nan, any_invalid_nan, any_sigNan);
+}
+
 #endif
@@ -0,0 +1,152 @@
+#include "devices.h"
+#include "mmu.h"
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Checks bus_t::find_device(), which looks pages up in the bus's page
+// tables, against find_device_slow(), which searches the device map, for
+// accesses around the edges of devices: on pages shared by several devices
+// or only partly covered by one, across page boundaries, and at the top of
+// the address space.
+
+class test_device_t : public abstract_device_t {
+ public:
+  test_device_t(reg_t size) : sz(size) {}
+  bool load(reg_t UNUSED addr, size_t UNUSED len, uint8_t UNUSED * bytes) override { return true; }
+  bool store(reg_t UNUSED addr, size_t UNUSED len, const uint8_t UNUSED * bytes) override { return true; }
+  reg_t size() override { return sz; }
+ private:
+  reg_t sz;
+};
+
+static int failures = 0;
+
+static void check(bus_t& bus, reg_t addr, size_t len)
+{
+  auto [base, dev] = bus.find_device(addr, len);
+  auto [want_base, want_dev] = bus.find_device_slow(addr, len);
+  if (addr + len - 1 < addr)
+    want_base = 0, want_dev = nullptr; // wraps around the address space
+  if (dev != want_dev || (dev && base != want_base)) {
+    if (failures++ < 10)
+      fprintf(stderr, "find_device(%" PRIx64 ", %zu) gives device %p at %" PRIx64 ", expected %p at %" PRIx64 "\n",
+              addr, len, (void*)dev, base, (void*)want_dev, want_base);
+  }
+}
+
+// Accesses of every size at and around the first and last bytes of each
+// device, and of the pages they fall in
+static void check_edges(bus_t& bus)
+{
+  std::vector<reg_t> points;
+  for (auto& [base, dev] : bus.get_devices()) {
+    reg_t end = base + dev->size();
+    for (reg_t edge : {base, end, base & ~reg_t(PGSIZE - 1), (end + PGSIZE - 1) & ~reg_t(PGSIZE - 1)}) {
+      for (reg_t delta = 0; delta < 16; delta++) {
+        points.push_back(edge + delta);
+        points.push_back(edge - 1 - delta);
+      }
+    }
+  }
+
+  for (reg_t addr : points) {
+    for (size_t len : {1, 2, 4, 8, 16})
+      check(bus, addr, len);
+  }
+}
+
+static void check_fixed_layout()
+{
+  test_device_t fallback(0);
+  bus_t bus(&fallback);
+  std::vector<std::unique_ptr<test_device_t>> devs;
+  auto add = [&](reg_t base, reg_t size) {
+    devs.emplace_back(new test_device_t(size));
+    bus.add_device(base, devs.back().get());
+  };
+
+  // three devices sharing a page, one of them covering the next pages too
+  add(0x10000, 0x10);
+  add(0x10800, 0x100);
+  add(0x10c00, 0x3400);
+  // a device covering whole pages, with no neighbours
+  add(0x80000000, 0x10000000);
+  // a partial page, then a device that ends exactly at 2^64
+  add(-reg_t(0x3000) - 0x80, 0x40);
+  add(-reg_t(0x3000), 0x3000);
+
+  check_edges(bus);
+
+  // devices starting part way into the last page of the address space,
+  // alone, with one ending at 2^64, and behind a device at address 0
+  for (int layout = 0; layout < 3; layout++) {
+    test_device_t fallback(0);
+    bus_t top_bus(&fallback);
+    std::vector<std::unique_ptr<test_device_t>> top_devs;
+    auto add_top = [&](reg_t base, reg_t size) {
+      top_devs.emplace_back(new test_device_t(size));
+      top_bus.add_device(base, top_devs.back().get());
+    };
+
+    if (layout == 2)
+      add_top(0, 0x2000);
+    add_top(-reg_t(0x800), layout == 1 ? 0x800 : 0x100);
+    check_edges(top_bus);
+    for (reg_t addr : {reg_t(0), reg_t(0x1000), reg_t(0x80000000), -reg_t(0x1000) - 8})
+      check(top_bus, addr, 8);
+  }
+
+  // accesses that cross into the next page, wherever they start
+  for (reg_t page : std::initializer_list<reg_t>{0x10000, 0x11000, 0x13000, 0x80000000, 0x8ffff000}) {
+    for (reg_t offset = PGSIZE - 8; offset < PGSIZE; offset++) {
+      for (size_t len : {2, 4, 8, 16})
+        check(bus, page + offset, len);
+    }
+  }
+}
+
+static void check_random_layouts()
+{
+  std::mt19937_64 rng(3);
+
+  for (int layout = 0; layout < 200; layout++) {
+    test_device_t fallback(0);
+    bus_t bus(&fallback);
+    std::vector<std::unique_ptr<test_device_t>> devs;
+
+    // Devices of a few bytes, a few pages or up to a GiB, separated by
+    // gaps of a few bytes or up to 4 GiB, sometimes reaching 2^64.
+    reg_t addr = layout % 2 ? 0 : rng() % 0x10000;
+    for (int i = 0; i < 20; i++) {
+      reg_t gap = rng() % (rng() % 2 ? 0x100 : 0x100000000);
+      reg_t size = 1 + rng() % (rng() % 3 == 0 ? 0x10 : rng() % 2 ? 0x3000 : 0x40000000);
+      addr += gap;
+      if (addr < gap || addr + size - 1 < addr)
+        break;
+      if (i == 19 && layout % 5 == 0)
+        size = -addr;
+      devs.emplace_back(new test_device_t(size));
+      bus.add_device(addr, devs.back().get());
+      addr += size;
+      if (addr == 0)
+        break;
+    }
+
+    check_edges(bus);
+    for (int i = 0; i < 10000; i++)
+      check(bus, rng(), size_t(1) << (rng() % 5));
+  }
+}
+
+int main()
+{
+  check_fixed_layout();
+  check_random_layouts();
+
+  if (failures)
+    fprintf(stderr, "%d mismatches between find_device() and find_device_slow()\n", failures);
+  return failures != 0;
+}
@@ -2,12 +2,16 @@
 
 #include "cachesim.h"
 #include "common.h"
+#include "arith.h"
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
-cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char* _name)
-: sets(_sets), ways(_ways), linesz(_linesz), name(_name), log(false)
+cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char* _name,
+                         replacement_t _policy, inclusion_t _inclusion)
+: sets(_sets), ways(_ways), linesz(_linesz), policy(_policy),
+  inclusion(_inclusion), name(_name), log(false)
 {
   init();
 }
@@ -15,26 +19,58 @@ cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char*
 static void help()
 {
   std::cerr << "Cache configurations must be of the form" << std::endl;
-  std::cerr << "  sets:ways:blocksize" << std::endl;
+  std::cerr << "  sets:ways:blocksize[:policy[:inclusion]]" << std::endl;
   std::cerr << "where sets, ways, and blocksize are positive integers, with" << std::endl;
-  std::cerr << "sets and blocksize both powers of two and blocksize at least 8." << std::endl;
+  std::cerr << "sets and blocksize both powers of two and blocksize at least 8;" << std::endl;
+  std::cerr << "policy is random (the default), lru, plru or rrip, with plru" << std::endl;
+  std::cerr << "needing ways to be a power of two; and inclusion, which relates" << std::endl;
+  std::cerr << "an L2 or L3 to the caches above it, is nine (the default)," << std::endl;
+  std::cerr << "inclusive or exclusive." << std::endl;
   exit(1);
 }
 
 cache_sim_t* cache_sim_t::construct(const char* config, const char* name)
 {
-  const char* wp = strchr(config, ':');
-  if (!wp++) help();
-  const char* bp = strchr(wp, ':');
-  if (!bp++) help();
+  std::vector<std::string> fields;
+  std::stringstream ss(config);
+  for (std::string field; std::getline(ss, field, ':'); )
+    fields.push_back(field);
+  if (fields.size() < 3 || fields.size() > 5)
+    help();
+
+  size_t sets = atoi(fields[0].c_str());
+  size_t ways = atoi(fields[1].c_str());
+  size_t linesz = atoi(fields[2].c_str());
+
+  replacement_t policy = RANDOM;
+  if (fields.size() > 3) {
+    if (fields[3] == "random")
+      policy = RANDOM;
+    else if (fields[3] == "lru")
+      policy = LRU;
+    else if (fields[3] == "plru")
+      policy = PLRU;
+    else if (fields[3] == "rrip")
+      policy = RRIP;
+    else
+      help();
+  }
 
-  size_t sets = atoi(std::string(config, wp).c_str());
-  size_t ways = atoi(std::string(wp, bp).c_str());
-  size_t linesz = atoi(bp);
+  inclusion_t inclusion = NINE;
+  if (fields.size() > 4) {
+    if (fields[4] == "nine")
+      inclusion = NINE;
+    else if (fields[4] == "inclusive")
+      inclusion = INCLUSIVE;
+    else if (fields[4] == "exclusive")
+      inclusion = EXCLUSIVE;
+    else
+      help();
+  }
 
   if (ways > 4 /* empirical */ && sets == 1)
-    return new fa_cache_sim_t(ways, linesz, name);
-  return new cache_sim_t(sets, ways, linesz, name);
+    return new fa_cache_sim_t(ways, linesz, name, policy, inclusion);
+  return new cache_sim_t(sets, ways, linesz, name, policy, inclusion);
 }
 
 void cache_sim_t::init()
@@ -43,12 +79,22 @@ void cache_sim_t::init()
     help();
   if (linesz < 8 || (linesz & (linesz-1)))
     help();
+  if (ways == 0 || (policy == PLRU && (ways & (ways-1))))
+    help();
 
   idx_shift = 0;
   for (size_t x = linesz; x>1; x >>= 1)
     idx_shift++;
 
   tags = new uint64_t[sets*ways]();
+
+  // LRU keeps a timestamp per line.  PLRU keeps a tree of ways - 1 bits per
+  // set, each pointing towards the less recently used half below it, and
+  // RRIP a 2-bit re-reference prediction per line, packed 32 to a word.
+  repl_words = policy == PLRU ? (ways + 63) / 64 : policy == RRIP ? (ways + 31) / 32 : 0;
+  repl.assign(policy == LRU ? sets * ways : sets * repl_words, 0);
+  clock = 0;
+
   read_accesses = 0;
   read_misses = 0;
   bytes_read = 0;
@@ -56,18 +102,33 @@ void cache_sim_t::init()
   write_misses = 0;
   bytes_written = 0;
   writebacks = 0;
+  back_invalidations = 0;
 
   miss_handler = NULL;
 }
 
 cache_sim_t::cache_sim_t(const cache_sim_t& rhs)
  : sets(rhs.sets), ways(rhs.ways), linesz(rhs.linesz),
-   idx_shift(rhs.idx_shift), name(rhs.name), log(false)
+   idx_shift(rhs.idx_shift), policy(rhs.policy), inclusion(rhs.inclusion),
+   repl(rhs.repl), repl_words(rhs.repl_words), clock(rhs.clock),
+   name(rhs.name), log(false)
 {
   tags = new uint64_t[sets*ways];
   memcpy(tags, rhs.tags, sets*ways*sizeof(uint64_t));
 }
 
+void cache_sim_t::set_miss_handler(cache_sim_t* mh)
+{
+  if (mh && mh->inclusion == EXCLUSIVE && mh->linesz != linesz) {
+    std::cerr << "An exclusive cache must have the same block size as the caches above it." << std::endl;
+    exit(1);
+  }
+
+  miss_handler = mh;
+  if (mh)
+    mh->upper.push_back(this);
+}
+
 cache_sim_t::~cache_sim_t()
 {
   print_stats();
@@ -93,6 +154,10 @@ void cache_sim_t::print_stats()
   std::cout << "Write Misses:          " << write_misses << std::endl;
   std::cout << name << " ";
   std::cout << "Writebacks:            " << writebacks << std::endl;
+  if (back_invalidations) {
+    std::cout << name << " ";
+    std::cout << "Back-invalidations:    " << back_invalidations << std::endl;
+  }
   std::cout << name << " ";
   std::cout << "Miss Rate:             " << mr << '%' << std::endl;
 }
@@ -112,12 +177,190 @@ uint64_t* cache_sim_t::check_tag(uint64_t addr)
 uint64_t cache_sim_t::victimize(uint64_t addr)
 {
   size_t idx = (addr >> idx_shift) & (sets-1);
-  size_t way = lfsr.next() % ways;
+  size_t way = ways;
+  if (policy != RANDOM) {
+    for (size_t i = 0; i < ways && way == ways; i++)
+      if (!(tags[idx*ways + i] & VALID))
+        way = i;
+  }
+  if (way == ways)
+    way = choose_victim(idx);
+
   uint64_t victim = tags[idx*ways + way];
   tags[idx*ways + way] = (addr >> idx_shift) | VALID;
+  touch(idx*ways + way, true);
   return victim;
 }
 
+void cache_sim_t::invalidate_line(uint64_t* line)
+{
+  *line &= ~VALID;
+}
+
+// fields of the RRIP word w that belong to ways of the set
+static uint64_t rrip_field_mask(size_t ways, size_t w)
+{
+  size_t n = std::min<size_t>(32, ways - w * 32);
+  uint64_t mask = 0x5555555555555555ULL;
+  return n == 32 ? mask : mask & ((1ULL << (2 * n)) - 1);
+}
+
+void cache_sim_t::touch(size_t line, bool fill)
+{
+  size_t set = line / ways, way = line % ways;
+  switch (policy) {
+    case RANDOM:
+      break;
+    case LRU:
+      repl[line] = ++clock;
+      break;
+    case PLRU: {
+      uint64_t* bits = &repl[set * repl_words];
+      size_t node = 0;
+      for (size_t half = ways / 2; half; half /= 2) {
+        bool right = way & half;
+        if (right)
+          bits[node / 64] &= ~(1ULL << (node % 64));
+        else
+          bits[node / 64] |= 1ULL << (node % 64);
+        node = 2 * node + 1 + right;
+      }
+      break;
+    }
+    case RRIP: {
+      // Static RRIP: a hit predicts a near re-reference, a fill a distant
+      // one, so that lines used only once leave before those used again.
+      uint64_t& word = repl[set * repl_words + way / 32];
+      unsigned shift = way % 32 * 2;
+      word = (word & ~(3ULL << shift)) | (uint64_t(fill ? 2 : 0) << shift);
+      break;
+    }
+  }
+}
+
+size_t cache_sim_t::choose_victim(size_t set)
+{
+  switch (policy) {
+    case LRU: {
+      size_t way = 0;
+      for (size_t i = 1; i < ways; i++)
+        if (repl[set*ways + i] < repl[set*ways + way])
+          way = i;
+      return way;
+    }
+    case PLRU: {
+      const uint64_t* bits = &repl[set * repl_words];
+      size_t node = 0, way = 0;
+      for (size_t half = ways / 2; half; half /= 2) {
+        bool right = (bits[node / 64] >> (node % 64)) & 1;
+        if (right)
+          way |= half;
+        node = 2 * node + 1 + right;
+      }
+      return way;
+    }
+    case RRIP: {
+      // Evict a line predicted to be re-referenced in the distant future
+      // (3), ageing the whole set until there is one.  No field is 3 when
+      // they are aged, so adding 1 to each cannot carry into the next.
+      uint64_t* words = &repl[set * repl_words];
+      while (true) {
+        for (size_t w = 0; w < repl_words; w++) {
+          uint64_t distant = words[w] & (words[w] >> 1) & rrip_field_mask(ways, w);
+          if (distant)
+            return w * 32 + ctz(distant) / 2;
+        }
+        for (size_t w = 0; w < repl_words; w++)
+          words[w] += rrip_field_mask(ways, w);
+      }
+    }
+    case RANDOM:
+    default:
+      return lfsr.next() % ways;
+  }
+}
+
+// Hand the bytes-long line at addr to a cache above that missed on it.  An
+// exclusive cache gives up its copy, returning whether it was dirty; others
+// simply see a read of the line.
+bool cache_sim_t::supply(uint64_t addr, size_t bytes)
+{
+  if (inclusion != EXCLUSIVE) {
+    access(addr, bytes, false);
+    return false;
+  }
+
+  read_accesses++;
+  bytes_read += bytes;
+  if (uint64_t* line = check_tag(addr)) {
+    bool dirty = *line & DIRTY;
+    invalidate_line(line);
+    return dirty;
+  }
+
+  read_misses++;
+  if (log)
+    std::cerr << name << " read miss 0x" << std::hex << addr << std::endl;
+  return miss_handler && miss_handler->supply(addr, bytes);
+}
+
+// Take in a line evicted from a cache above, as an exclusive cache does.
+void cache_sim_t::fill(uint64_t addr, bool dirty)
+{
+  uint64_t* line = check_tag(addr);
+  if (line) {
+    touch(line - tags, false);
+  } else {
+    evict(victimize(addr));
+    line = check_tag(addr);
+  }
+
+  if (dirty)
+    *line |= DIRTY;
+}
+
+// Write back or pass down a line that victimize() has displaced.  An
+// inclusive cache first takes it away from the caches above.
+void cache_sim_t::evict(uint64_t victim)
+{
+  if (!(victim & VALID))
+    return;
+
+  uint64_t victim_addr = (victim & ~(VALID | DIRTY)) << idx_shift;
+  if (inclusion == INCLUSIVE) {
+    for (auto c : upper)
+      victim |= c->back_invalidate(victim_addr, linesz);
+  }
+
+  bool dirty = victim & DIRTY;
+  if (dirty)
+    writebacks++;
+
+  if (miss_handler && miss_handler->inclusion == EXCLUSIVE)
+    miss_handler->fill(victim_addr, dirty);
+  else if (miss_handler && dirty)
+    miss_handler->access(victim_addr, linesz, true);
+}
+
+// Drop the lines covering [addr, addr + bytes) from this cache and those
+// above it, returning DIRTY if any of them was dirty.
+uint64_t cache_sim_t::back_invalidate(uint64_t addr, size_t bytes)
+{
+  uint64_t dirty = 0;
+  for (auto c : upper)
+    dirty |= c->back_invalidate(addr, bytes);
+
+  for (uint64_t a = addr & ~(linesz-1); a < addr + bytes; a += linesz) {
+    if (uint64_t* line = check_tag(a)) {
+      dirty |= *line & DIRTY;
+      invalidate_line(line);
+      back_invalidations++;
+    }
+  }
+
+  return dirty;
+}
+
 void cache_sim_t::access(uint64_t addr, size_t bytes, bool store)
 {
   store ? write_accesses++ : read_accesses++;
@@ -128,6 +371,7 @@ void cache_sim_t::access(uint64_t addr, size_t bytes, bool store)
   {
     if (store)
       *hit_way |= DIRTY;
+    touch(hit_way - tags, false);
     return;
   }
 
@@ -139,20 +383,11 @@ void cache_sim_t::access(uint64_t addr, size_t bytes, bool store)
               << std::hex << addr << std::endl;
   }
 
-  uint64_t victim = victimize(addr);
+  evict(victimize(addr));
 
-  if ((victim & (VALID | DIRTY)) == (VALID | DIRTY))
-  {
-    uint64_t dirty_addr = (victim & ~(VALID | DIRTY)) << idx_shift;
-    if (miss_handler)
-      miss_handler->access(dirty_addr, linesz, true);
-    writebacks++;
-  }
-
-  if (miss_handler)
-    miss_handler->access(addr & ~(linesz-1), linesz, false);
+  bool dirty = miss_handler && miss_handler->supply(addr & ~(linesz-1), linesz);
 
-  if (store)
+  if (store || dirty)
     *check_tag(addr) |= DIRTY;
 }
 
@@ -173,7 +408,7 @@ void cache_sim_t::clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool
       }
 
       if (inval)
-        *hit_way &= ~VALID;
+        invalidate_line(hit_way);
     }
     cur_addr += linesz;
   }
@@ -181,27 +416,74 @@ void cache_sim_t::clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool
     miss_handler->clean_invalidate(addr, bytes, clean, inval);
 }
 
-fa_cache_sim_t::fa_cache_sim_t(size_t ways, size_t linesz, const char* name)
-  : cache_sim_t(1, ways, linesz, name)
+fa_cache_sim_t::fa_cache_sim_t(size_t ways, size_t linesz, const char* name,
+                               replacement_t policy, inclusion_t inclusion)
+  : cache_sim_t(1, ways, linesz, name, policy, inclusion),
+    prev(ways + 1), next(ways + 1)
 {
+  lines.reserve(ways);
+  for (size_t i = 0; i < ways; i++)
+    free_lines.push_back(ways - 1 - i);
+
+  // a line is off the LRU list when it links to itself
+  for (size_t i = 0; i <= ways; i++)
+    prev[i] = next[i] = i;
 }
 
 uint64_t* fa_cache_sim_t::check_tag(uint64_t addr)
 {
-  auto it = tags.find(addr >> idx_shift);
-  return it == tags.end() ? NULL : &it->second;
+  auto it = lines.find(addr >> idx_shift);
+  return it == lines.end() ? NULL : &tags[it->second];
 }
 
 uint64_t fa_cache_sim_t::victimize(uint64_t addr)
 {
-  uint64_t old_tag = 0;
-  if (tags.size() == ways)
-  {
-    auto it = tags.begin();
-    std::advance(it, lfsr.next() % ways);
-    old_tag = it->second;
-    tags.erase(it);
+  size_t line;
+  if (!free_lines.empty()) {
+    line = free_lines.back();
+    free_lines.pop_back();
+  } else {
+    line = choose_victim(0);
+  }
+
+  uint64_t victim = tags[line];
+  if (victim & VALID)
+    lines.erase(victim & ~(VALID | DIRTY));
+  tags[line] = (addr >> idx_shift) | VALID;
+  lines[addr >> idx_shift] = line;
+  touch(line, true);
+  return victim;
+}
+
+void fa_cache_sim_t::invalidate_line(uint64_t* line)
+{
+  size_t i = line - tags;
+  if (*line & VALID) {
+    lines.erase(*line & ~(VALID | DIRTY));
+    free_lines.push_back(i);
+    next[prev[i]] = next[i];
+    prev[next[i]] = prev[i];
+    prev[i] = next[i] = i;
   }
-  tags[addr >> idx_shift] = (addr >> idx_shift) | VALID;
-  return old_tag;
+  cache_sim_t::invalidate_line(line);
+}
+
+void fa_cache_sim_t::touch(size_t line, bool fill)
+{
+  if (policy != LRU) {
+    cache_sim_t::touch(line, fill);
+    return;
+  }
+
+  next[prev[line]] = next[line];
+  prev[next[line]] = prev[line];
+  prev[line] = ways;
+  next[line] = next[ways];
+  prev[next[ways]] = line;
+  next[ways] = line;
+}
+
+size_t fa_cache_sim_t::choose_victim(size_t set)
+{
+  return policy == LRU ? prev[ways] : cache_sim_t::choose_victim(set);
 }
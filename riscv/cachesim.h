@@ -7,7 +7,8 @@
 #include "common.h"
 #include <cstring>
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
 
 class lfsr_t
@@ -23,14 +24,21 @@ class lfsr_t
 class cache_sim_t
 {
  public:
-  cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name);
+  // how a line is chosen for eviction from a full set
+  enum replacement_t { RANDOM, LRU, PLRU, RRIP };
+  // what a cache holds relative to the caches whose misses it handles:
+  // NINE is neither inclusive nor exclusive
+  enum inclusion_t { NINE, INCLUSIVE, EXCLUSIVE };
+
+  cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name,
+              replacement_t policy = RANDOM, inclusion_t inclusion = NINE);
   cache_sim_t(const cache_sim_t& rhs);
   virtual ~cache_sim_t();
 
   void access(uint64_t addr, size_t bytes, bool store);
   void clean_invalidate(uint64_t addr, size_t bytes, bool clean, bool inval);
   void print_stats();
-  void set_miss_handler(cache_sim_t* mh) { miss_handler = mh; }
+  void set_miss_handler(cache_sim_t* mh);
   void set_log(bool _log) { log = _log; }
 
   static cache_sim_t* construct(const char* config, const char* name);
@@ -41,17 +49,35 @@ class cache_sim_t
 
   virtual uint64_t* check_tag(uint64_t addr);
   virtual uint64_t victimize(uint64_t addr);
+  virtual void invalidate_line(uint64_t* line);
+
+  // Replacement state is kept per line (LRU) or packed per set (PLRU, RRIP)
+  // in repl, and indexed by line number, set * ways + way.
+  virtual void touch(size_t line, bool fill);
+  virtual size_t choose_victim(size_t set);
+
+  // hierarchy
+  bool supply(uint64_t addr, size_t bytes);
+  void fill(uint64_t addr, bool dirty);
+  void evict(uint64_t victim);
+  uint64_t back_invalidate(uint64_t addr, size_t bytes);
 
   lfsr_t lfsr;
   cache_sim_t* miss_handler;
+  std::vector<cache_sim_t*> upper; // caches whose misses this one handles
 
   size_t sets;
   size_t ways;
   size_t linesz;
   size_t idx_shift;
+  replacement_t policy;
+  inclusion_t inclusion;
 
   uint64_t* tags;
-  
+  std::vector<uint64_t> repl;
+  size_t repl_words; // per set for PLRU and RRIP
+  uint64_t clock;
+
   uint64_t read_accesses;
   uint64_t read_misses;
   uint64_t bytes_read;
@@ -59,6 +85,7 @@ class cache_sim_t
   uint64_t write_misses;
   uint64_t bytes_written;
   uint64_t writebacks;
+  uint64_t back_invalidations;
 
   std::string name;
   bool log;
@@ -66,15 +93,25 @@ class cache_sim_t
   void init();
 };
 
+// A fully associative cache, whose tags are found through a hash table
+// rather than by searching the set, and whose LRU order is kept in a list,
+// so that both hits and misses take constant time however many ways it has.
 class fa_cache_sim_t : public cache_sim_t
 {
  public:
-  fa_cache_sim_t(size_t ways, size_t linesz, const char* name);
+  fa_cache_sim_t(size_t ways, size_t linesz, const char* name,
+                 replacement_t policy = RANDOM, inclusion_t inclusion = NINE);
   uint64_t* check_tag(uint64_t addr);
   uint64_t victimize(uint64_t addr);
+  void invalidate_line(uint64_t* line);
+  void touch(size_t line, bool fill);
+  size_t choose_victim(size_t set);
  private:
-  static bool cmp(uint64_t a, uint64_t b);
-  std::map<uint64_t, uint64_t> tags;
+  std::unordered_map<uint64_t, size_t> lines;
+  std::vector<size_t> free_lines;
+  // LRU list through the lines, most recent first, with ways as its head
+  std::vector<size_t> prev;
+  std::vector<size_t> next;
 };
 
 class cache_memtracer_t : public memtracer_t
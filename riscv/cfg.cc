@@ -45,6 +45,9 @@ cfg_t::cfg_t()
   hartids          = std::vector<size_t>({0});
   explicit_hartids = false;
   real_time_clint  = false;
+  parallel_harts   = false;
+  tlb_entries      = 4096;
+  host_fp          = false;
   trigger_count    = 4;
   cache_blocksz    = 64;
 }
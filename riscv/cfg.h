@@ -91,6 +91,9 @@ public:
   std::vector<size_t>     hartids;
   bool                    explicit_hartids;
   bool                    real_time_clint;
+  bool                    parallel_harts;
+  reg_t                   tlb_entries;
+  bool                    host_fp;
   reg_t                   trigger_count;
   reg_t                   cache_blocksz;
   std::optional<abstract_sim_if_t*> external_simulator;
@@ -0,0 +1,89 @@
+// See LICENSE for license details.
+
+#include "config.h"
+#include "sim.h"
+#include "mmu.h"
+#include "checkpoint.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// A checkpoint holds the simulator's position within the current quantum,
+// then every hart, then every device on the bus in address order.  Memories
+// are devices too, so RAM is saved by mem_t::save().
+
+void sim_t::save_checkpoint(const std::string& path)
+{
+  std::ofstream o(path, std::ios::binary);
+  if (!o) {
+    std::cerr << "Unable to create checkpoint '" << path << "'" << std::endl;
+    exit(1);
+  }
+
+  o.write(CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC));
+  checkpoint_put(o, uint32_t(CHECKPOINT_VERSION));
+  checkpoint_put(o, uint64_t(quantum));
+  checkpoint_put(o, uint64_t(current_step));
+  checkpoint_put(o, uint64_t(current_proc));
+
+  checkpoint_put(o, uint64_t(procs.size()));
+  for (auto p : procs) {
+    checkpoint_put(o, uint64_t(p->get_id()));
+    p->save(o);
+  }
+
+  checkpoint_put(o, uint64_t(bus.get_devices().size()));
+  for (auto& [base, dev] : bus.get_devices()) {
+    checkpoint_put(o, base);
+    dev->save(o);
+  }
+
+  if (!o.flush()) {
+    std::cerr << "Error writing checkpoint '" << path << "'" << std::endl;
+    exit(1);
+  }
+}
+
+void sim_t::restore_checkpoint(const std::string& path)
+{
+  std::ifstream i(path, std::ios::binary);
+  if (!i) {
+    std::cerr << "Unable to open checkpoint '" << path << "'" << std::endl;
+    exit(1);
+  }
+
+  try {
+    char magic[sizeof(CHECKPOINT_MAGIC) - 1];
+    if (!i.read(magic, sizeof(magic)) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+      throw std::runtime_error("not a checkpoint file");
+    checkpoint_expect(i, uint32_t(CHECKPOINT_VERSION), "version");
+
+    uint64_t length, step, proc;
+    checkpoint_get(i, length);
+    checkpoint_get(i, step);
+    checkpoint_get(i, proc);
+    if (length == 0 || length > INTERLEAVE || step >= length || proc >= procs.size())
+      throw std::runtime_error("checkpoint is corrupt");
+    quantum = length;
+    current_step = step;
+    current_proc = proc;
+
+    checkpoint_expect(i, uint64_t(procs.size()), "number of harts");
+    for (auto p : procs) {
+      checkpoint_expect(i, uint64_t(p->get_id()), "hart IDs");
+      p->restore(i);
+    }
+
+    checkpoint_expect(i, uint64_t(bus.get_devices().size()), "number of devices");
+    for (auto& [base, dev] : bus.get_devices()) {
+      checkpoint_expect(i, base, "device addresses");
+      dev->restore(i);
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Unable to restore checkpoint '" << path << "': " << e.what() << std::endl;
+    exit(1);
+  }
+
+  // the program loader may have left translations behind
+  debug_mmu->flush_tlb();
+}
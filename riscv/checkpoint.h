@@ -0,0 +1,44 @@
+// See LICENSE for license details.
+#ifndef _RISCV_CHECKPOINT_H
+#define _RISCV_CHECKPOINT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Snapshots are a flat sequence of fixed-size fields in host byte order.
+// They are only meant to be restored by the same version of the simulator,
+// on the same kind of host, with the same command line; the version number
+// is bumped whenever the layout changes.
+#define CHECKPOINT_MAGIC "SPIKECKP"
+#define CHECKPOINT_VERSION 2
+
+template<typename T>
+void checkpoint_put(std::ostream& o, const T& val)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "field must be plain data");
+  o.write((const char*)&val, sizeof(val));
+}
+
+template<typename T>
+void checkpoint_get(std::istream& i, T& val)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "field must be plain data");
+  if (!i.read((char*)&val, sizeof(val)))
+    throw std::runtime_error("checkpoint is truncated");
+}
+
+// Read a field that must match the value in the running simulator.
+template<typename T>
+void checkpoint_expect(std::istream& i, const T& val, const char* what)
+{
+  T saved;
+  checkpoint_get(i, saved);
+  if (saved != val)
+    throw std::runtime_error(std::string("checkpoint does not match this configuration: ") + what);
+}
+
+#endif
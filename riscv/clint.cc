@@ -5,6 +5,7 @@
 #include "simif.h"
 #include "sim.h"
 #include "dts.h"
+#include "checkpoint.h"
 
 clint_t::clint_t(const simif_t* sim, uint64_t freq_hz, bool real_time)
   : sim(sim), freq_hz(freq_hz), real_time(real_time), mtime(0)
@@ -118,6 +119,61 @@ void clint_t::tick(reg_t rtc_ticks)
   }
 }
 
+reg_t clint_t::next_event()
+{
+  if (real_time)
+    return UINT64_MAX;
+
+  // Only timers whose interrupts are enabled in mie can wake a hart from
+  // WFI, and a comparator of all ones is how software turns a timer off.
+  reg_t next = UINT64_MAX;
+  auto until = [&](reg_t cmp, reg_t delta = 0) {
+    reg_t deadline = cmp - delta;
+    if (cmp != UINT64_MAX && deadline > mtime)
+      next = std::min(next, deadline - mtime);
+  };
+
+  for (const auto& [hart_id, hart] : sim->get_harts()) {
+    const reg_t mie = hart->state.mie->read();
+    if (auto it = mtimecmp.find(hart_id); it != mtimecmp.end() && (mie & MIP_MTIP))
+      until(it->second);
+    if (hart->extension_enabled(EXT_SSTC)) {
+      if ((mie & MIP_STIP) && (hart->state.menvcfg->read() & MENVCFG_STCE))
+        until(hart->state.stimecmp->read());
+      if ((mie & MIP_VSTIP) && (hart->state.henvcfg->read() & HENVCFG_STCE))
+        until(hart->state.vstimecmp->read(), hart->state.htimedelta->read());
+    }
+  }
+
+  return next;
+}
+
+void clint_t::save(std::ostream& o)
+{
+  checkpoint_put(o, mtime);
+  checkpoint_put(o, uint64_t(mtimecmp.size()));
+  for (auto& [hart_id, cmp] : mtimecmp) {
+    checkpoint_put(o, uint64_t(hart_id));
+    checkpoint_put(o, cmp);
+  }
+}
+
+void clint_t::restore(std::istream& i)
+{
+  checkpoint_get(i, mtime);
+  uint64_t n;
+  checkpoint_get(i, n);
+  mtimecmp.clear();
+  for (uint64_t k = 0; k < n; k++) {
+    uint64_t hart_id;
+    checkpoint_get(i, hart_id);
+    checkpoint_get(i, mtimecmp[hart_id]);
+  }
+
+  // bring the harts' time CSRs and timer interrupts up to date
+  tick(0);
+}
+
 clint_t* clint_parse_from_fdt(const void* fdt, const sim_t* sim, reg_t* base,
     const std::vector<std::string>& sargs UNUSED) {
   if (fdt_parse_clint(fdt, base, "riscv,clint0") == 0 || fdt_parse_clint(fdt, base, "sifive,clint0") == 0)
@@ -0,0 +1,106 @@
+// See LICENSE for license details.
+
+#include "commit_log.h"
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+void commit_log_print_value(FILE *log_file, int width, const void *data)
+{
+  assert(log_file);
+
+  switch (width) {
+    case 8:
+      fprintf(log_file, "0x%02" PRIx8, *(const uint8_t *)data);
+      break;
+    case 16:
+      fprintf(log_file, "0x%04" PRIx16, *(const uint16_t *)data);
+      break;
+    case 32:
+      fprintf(log_file, "0x%08" PRIx32, *(const uint32_t *)data);
+      break;
+    case 64:
+      fprintf(log_file, "0x%016" PRIx64, *(const uint64_t *)data);
+      break;
+    default:
+      if (width % 8 == 0) {
+        const uint8_t *arr = (const uint8_t *)data;
+
+        fprintf(log_file, "0x");
+        for (int idx = width / 8 - 1; idx >= 0; --idx) {
+          fprintf(log_file, "%02" PRIx8, arr[idx]);
+        }
+      } else {
+        abort();
+      }
+      break;
+  }
+}
+
+void commit_log_print_value(FILE *log_file, int width, uint64_t val)
+{
+  commit_log_print_value(log_file, width, &val);
+}
+
+commit_log_writer_t::commit_log_writer_t(FILE* file)
+  : file(file), ring(RING_SIZE), head(0), tail(0), exiting(false)
+{
+  uint32_t version = COMMIT_LOG_VERSION;
+  uint8_t le_version[4] = {uint8_t(version), uint8_t(version >> 8), uint8_t(version >> 16), uint8_t(version >> 24)};
+  fwrite(COMMIT_LOG_MAGIC, 1, strlen(COMMIT_LOG_MAGIC), file);
+  fwrite(le_version, 1, sizeof(le_version), file);
+
+  thread = std::thread([this] { thread_main(); });
+}
+
+commit_log_writer_t::~commit_log_writer_t()
+{
+  exiting.store(true, std::memory_order_release);
+  thread.join();
+  fflush(file);
+}
+
+void commit_log_writer_t::write(const uint8_t* data, size_t len)
+{
+  std::lock_guard<std::mutex> lock(producer_lock);
+
+  while (len > 0) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t space;
+    while ((space = RING_SIZE - (h - tail.load(std::memory_order_acquire))) == 0)
+      std::this_thread::yield();
+
+    size_t offset = h % RING_SIZE;
+    size_t n = std::min({len, space, RING_SIZE - offset});
+    memcpy(&ring[offset], data, n);
+    head.store(h + n, std::memory_order_release);
+
+    data += n;
+    len -= n;
+  }
+}
+
+void commit_log_writer_t::thread_main()
+{
+  while (true) {
+    // read exiting first so that everything produced before it was set
+    // is seen below
+    bool done = exiting.load(std::memory_order_acquire);
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+
+    if (h == t) {
+      if (done)
+        return;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    size_t offset = t % RING_SIZE;
+    size_t n = std::min(h - t, RING_SIZE - offset);
+    fwrite(&ring[offset], 1, n, file);
+    tail.store(t + n, std::memory_order_release);
+  }
+}
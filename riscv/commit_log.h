@@ -0,0 +1,130 @@
+// See LICENSE for license details.
+#ifndef _RISCV_COMMIT_LOG_H
+#define _RISCV_COMMIT_LOG_H
+
+#include "common.h"
+#include "decode.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Binary commit log, written with --log-commits-binary and turned back into
+// the --log-commits text format by spike-log-decode.
+//
+// The file starts with COMMIT_LOG_MAGIC and a 32-bit little-endian version,
+// followed by records that each begin with a tag byte.  A varint is an
+// unsigned LEB128 number and an svarint is a zigzag-encoded varint.
+//
+//   COMMIT_LOG_HART  varint hart ID; the records that follow belong to it
+//   COMMIT_LOG_INSN  one retired instruction:
+//     u8      priv | (xlen == 64) << 2 | flen code << 3 | vector state << 6,
+//             where the flen code is 0 for none, then 1..4 for 16..128 bits
+//     svarint pc minus the fall-through pc of the hart's previous record
+//     bytes   the instruction, insn_length() bytes
+//     if vector state: varint VLEN, varint SEW, svarint LMUL (-n for 1/n)
+//             and varint vl
+//     varint  number of register writes, each a varint log_reg_write key
+//             followed by a varint value for x and CSR writes, flen/8 bytes
+//             for f writes, VLEN/8 bytes for v writes, or nothing for
+//             vector configuration writes
+//     varint  number of loads, each a varint address
+//     varint  number of stores, each a varint address, a u8 size in bytes
+//             and a varint value
+#define COMMIT_LOG_MAGIC "SPIKECLG"
+#define COMMIT_LOG_VERSION 1
+
+enum commit_log_tag_t : uint8_t {
+  COMMIT_LOG_HART = 1,
+  COMMIT_LOG_INSN = 2,
+};
+
+void commit_log_print_value(FILE *log_file, int width, const void *data);
+void commit_log_print_value(FILE *log_file, int width, uint64_t val);
+
+// Streams the log to a file from a background thread.  Producers copy whole
+// blocks of records into a single-consumer ring buffer; they only block when
+// the writer falls a full ring behind.
+class commit_log_writer_t
+{
+public:
+  commit_log_writer_t(FILE* file);
+  ~commit_log_writer_t();
+
+  void write(const uint8_t* data, size_t len);
+
+private:
+  void thread_main();
+
+  static const size_t RING_SIZE = 1 << 24;
+
+  FILE* file;
+  std::vector<uint8_t> ring;
+  std::atomic<size_t> head; // total bytes produced
+  std::atomic<size_t> tail; // total bytes written to the file
+  std::atomic<bool> exiting;
+  std::mutex producer_lock; // harts may run on separate threads
+  std::thread thread;
+};
+
+// Per-hart encoder.  Records are staged here and handed to the writer a
+// block at a time; every block starts with a COMMIT_LOG_HART record.
+class commit_log_encoder_t
+{
+public:
+  commit_log_encoder_t(commit_log_writer_t* writer, uint32_t hart_id)
+    : next_pc(0), writer(writer), hart_id(hart_id)
+  {
+    start_block();
+  }
+  ~commit_log_encoder_t() { flush(); }
+
+  void put_u8(uint8_t val) { buf.push_back(val); }
+  void put_bytes(const void* data, size_t len)
+  {
+    buf.insert(buf.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+  }
+  void put_varint(uint64_t val)
+  {
+    for (; val >= 0x80; val >>= 7)
+      buf.push_back(uint8_t(val) | 0x80);
+    buf.push_back(uint8_t(val));
+  }
+  void put_svarint(int64_t val) { put_varint((uint64_t(val) << 1) ^ uint64_t(val >> 63)); }
+
+  // called after each record; passes the block on once it is large enough
+  void end_record()
+  {
+    if (unlikely(buf.size() >= BLOCK_SIZE))
+      flush();
+  }
+
+  void flush()
+  {
+    if (buf.size() > block_header_size)
+      writer->write(buf.data(), buf.size());
+    start_block();
+  }
+
+  reg_t next_pc; // fall-through pc of the previous record
+
+private:
+  void start_block()
+  {
+    buf.clear();
+    put_u8(COMMIT_LOG_HART);
+    put_varint(hart_id);
+    block_header_size = buf.size();
+  }
+
+  static const size_t BLOCK_SIZE = 1 << 16;
+
+  commit_log_writer_t* writer;
+  uint32_t hart_id;
+  std::vector<uint8_t> buf;
+  size_t block_header_size;
+};
+
+#endif
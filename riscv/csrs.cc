@@ -618,7 +618,7 @@ void base_status_csr_t::maybe_flush_tlb(const reg_t newval) noexcept {
       (MSTATUS_MPP | MSTATUS_MPRV
        | (has_page ? (MSTATUS_MXR | MSTATUS_SUM) : 0)
       ))
-    proc->get_mmu()->flush_tlb();
+    proc->get_mmu()->flush_tlb_context();
 }
 
 namespace {
@@ -935,12 +935,21 @@ mip_or_mie_csr_t::mip_or_mie_csr_t(processor_t* const proc, const reg_t addr):
   val(0) {
 }
 
+// With --parallel-harts, the CLINT and PLIC set bits in mip from other
+// harts' threads, so mip/mie are read and updated atomically.
 reg_t mip_or_mie_csr_t::read() const noexcept {
-  return val;
+  return __atomic_load_n(&val, __ATOMIC_RELAXED);
+}
+
+void mip_or_mie_csr_t::atomic_write_with_mask(const reg_t mask, const reg_t val) noexcept {
+  reg_t old_val = __atomic_load_n(&this->val, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&this->val, &old_val, (old_val & ~mask) | (val & mask),
+                                      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
 }
 
 void mip_or_mie_csr_t::write_with_mask(const reg_t mask, const reg_t val) noexcept {
-  this->val = (this->val & ~mask) | (val & mask);
+  atomic_write_with_mask(mask, val);
   log_write();
 }
 
@@ -960,11 +969,11 @@ void mip_csr_t::write_with_mask(const reg_t mask, const reg_t val) noexcept {
 }
 
 reg_t mip_csr_t::read() const noexcept {
-  return val | state->hvip->basic_csr_t::read() | ((state->mvien->read() & MIP_SEIP) ? 0 : (state->mvip->basic_csr_t::read() & MIP_SEIP));
+  return mip_or_mie_csr_t::read() | state->hvip->basic_csr_t::read() | ((state->mvien->read() & MIP_SEIP) ? 0 : (state->mvip->basic_csr_t::read() & MIP_SEIP));
 }
 
 void mip_csr_t::backdoor_write_with_mask(const reg_t mask, const reg_t val) noexcept {
-  this->val = (this->val & ~mask) | (val & mask);
+  atomic_write_with_mask(mask, val);
 }
 
 reg_t mip_csr_t::write_mask() const noexcept {
@@ -1232,7 +1241,7 @@ base_atp_csr_t::base_atp_csr_t(processor_t* const proc, const reg_t addr):
 bool base_atp_csr_t::unlogged_write(const reg_t val) noexcept {
   const reg_t newval = proc->has_mmu() ? compute_new_satp(val) : 0;
   if (newval != read())
-    proc->get_mmu()->flush_tlb();
+    proc->get_mmu()->flush_tlb_context();
   return basic_csr_t::unlogged_write(newval);
 }
 
@@ -1475,7 +1484,7 @@ void hgatp_csr_t::verify_permissions(insn_t insn, bool write) const {
 }
 
 bool hgatp_csr_t::unlogged_write(const reg_t val) noexcept {
-  proc->get_mmu()->flush_tlb();
+  proc->get_mmu()->flush_tlb_context();
 
   reg_t mask;
   if (proc->get_const_xlen() == 32) {
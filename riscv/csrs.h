@@ -379,6 +379,7 @@ class mip_or_mie_csr_t: public csr_t {
 
  protected:
   virtual bool unlogged_write(const reg_t val) noexcept override final;
+  void atomic_write_with_mask(const reg_t mask, const reg_t val) noexcept;
   reg_t val;
  private:
   virtual reg_t write_mask() const noexcept = 0;
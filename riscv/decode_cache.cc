@@ -0,0 +1,85 @@
+// See LICENSE for license details.
+
+#include "decode_cache.h"
+#include "processor.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+  struct decode_cache_entry_t {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> config; // 0 if invalid
+    std::atomic<reg_t> paddr;
+    std::atomic<insn_bits_t> bits;
+    std::atomic<insn_func_t> func;
+  };
+
+  const size_t DECODE_CACHE_ENTRIES = 1 << 15;
+  decode_cache_entry_t decode_cache[DECODE_CACHE_ENTRIES];
+
+  decode_cache_entry_t& decode_cache_entry(reg_t paddr)
+  {
+    return decode_cache[(paddr / PC_ALIGN) % DECODE_CACHE_ENTRIES];
+  }
+
+  std::mutex configs_lock;
+  std::vector<std::vector<opcode_map_entry_t>> configs;
+}
+
+uint32_t decode_cache_t::config_id(const std::vector<opcode_map_entry_t>* opcode_map, size_t n)
+{
+  std::vector<opcode_map_entry_t> flat;
+  for (size_t i = 0; i < n; i++) {
+    flat.insert(flat.end(), opcode_map[i].begin(), opcode_map[i].end());
+    flat.push_back({0, 0, nullptr}); // bucket separator
+  }
+
+  auto same = [](const opcode_map_entry_t& a, const opcode_map_entry_t& b) {
+    return a.match == b.match && a.mask == b.mask && a.func == b.func;
+  };
+
+  std::lock_guard<std::mutex> lock(configs_lock);
+  for (size_t i = 0; i < configs.size(); i++) {
+    if (std::equal(flat.begin(), flat.end(), configs[i].begin(), configs[i].end(), same))
+      return i + 1;
+  }
+
+  configs.push_back(std::move(flat));
+  return configs.size();
+}
+
+insn_func_t decode_cache_t::lookup(reg_t paddr, insn_bits_t bits, uint32_t config)
+{
+  auto& entry = decode_cache_entry(paddr);
+  uint32_t seq = entry.seq.load(std::memory_order_acquire);
+  if (seq & 1)
+    return nullptr;
+
+  bool hit = entry.config.load(std::memory_order_relaxed) == config &&
+             entry.paddr.load(std::memory_order_relaxed) == paddr &&
+             entry.bits.load(std::memory_order_relaxed) == bits;
+  insn_func_t func = entry.func.load(std::memory_order_relaxed);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!hit || entry.seq.load(std::memory_order_relaxed) != seq)
+    return nullptr;
+
+  return func;
+}
+
+void decode_cache_t::insert(reg_t paddr, insn_bits_t bits, uint32_t config, insn_func_t func)
+{
+  // if another hart is writing this entry, leave it to them
+  auto& entry = decode_cache_entry(paddr);
+  uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+  if ((seq & 1) || !entry.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed))
+    return;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  entry.config.store(config, std::memory_order_relaxed);
+  entry.paddr.store(paddr, std::memory_order_relaxed);
+  entry.bits.store(bits, std::memory_order_relaxed);
+  entry.func.store(func, std::memory_order_relaxed);
+
+  entry.seq.store(seq + 2, std::memory_order_release);
+}
@@ -0,0 +1,37 @@
+// See LICENSE for license details.
+#ifndef _RISCV_DECODE_CACHE_H
+#define _RISCV_DECODE_CACHE_H
+
+#include "decode.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class processor_t;
+struct opcode_map_entry_t;
+typedef reg_t (*insn_func_t)(processor_t*, insn_t, reg_t);
+
+// Decoded instructions shared by every hart in the process, indexed by the
+// physical address they were fetched from, so that harts running the same
+// code decode it once between them.
+//
+// Harts share entries only if their opcode maps are identical, which
+// config_id() determines; a hart with another ISA, XLEN or logging mode gets
+// its own ID.  Entries also carry the instruction bits they were decoded
+// from, so code that has since been overwritten simply misses.
+//
+// The table is read far more often than it is written.  Lookups take no
+// lock: each entry has a sequence number that is odd while it is being
+// written, and a lookup that sees it change retries as a miss.
+class decode_cache_t
+{
+public:
+  // a nonzero ID shared by all opcode maps equal to this one
+  static uint32_t config_id(const std::vector<opcode_map_entry_t>* opcode_map, size_t n);
+
+  // returns nullptr on a miss
+  static insn_func_t lookup(reg_t paddr, insn_bits_t bits, uint32_t config);
+  static void insert(reg_t paddr, insn_bits_t bits, uint32_t config, insn_func_t func);
+};
+
+#endif
@@ -230,6 +230,9 @@ static inline bool is_aligned(const unsigned val, const unsigned pos)
     softfloat_exceptionFlags = 0; \
   } while (0);
 
+// f32_add(a, b) etc., or host_f32_add(a, b) etc. under --host-fp
+#define HOST_FP(op, ...) (p->get_cfg().host_fp ? host_##op(__VA_ARGS__) : op(__VA_ARGS__))
+
 #define sext32(x) ((sreg_t)(int32_t)(x))
 #define zext32(x) ((reg_t)(uint32_t)(x))
 #define sext(x, pos) (((sreg_t)(x) << (64 - (pos))) >> (64 - (pos)))
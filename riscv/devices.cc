@@ -1,6 +1,12 @@
 #include "devices.h"
 #include "mmu.h"
+#include "checkpoint.h"
+#include <cstring>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <unistd.h>
 
 mmio_device_map_t& mmio_device_map()
 {
@@ -18,6 +24,38 @@ bus_t::bus_t()
 bus_t::bus_t(abstract_device_t* fallback)
   : fallback(fallback)
 {
+  page_tables.emplace_back(new page_table_t);
+}
+
+void bus_t::map_pages(page_table_t* table, int level, reg_t first, reg_t last, uintptr_t entry)
+{
+  const int shift = (PAGE_TABLE_LEVELS - 1 - level) * PAGE_TABLE_BITS;
+  const reg_t mask = (reg_t(1) << PAGE_TABLE_BITS) - 1;
+  const reg_t span = reg_t(1) << shift; // pages per entry
+
+  for (reg_t idx = (first >> shift) & mask; ; idx++) {
+    reg_t entry_first = (first & ~((span << PAGE_TABLE_BITS) - 1)) + idx * span;
+    reg_t entry_last = entry_first + span - 1;
+    uintptr_t& e = table->entries[idx];
+
+    if (first <= entry_first && entry_last <= last) {
+      // devices don't overlap, so a page has nothing else mapped unless it
+      // is shared
+      assert(!(e & 1) && (e == 0 || (e == PAGE_SHARED && entry == PAGE_SHARED)));
+      e = entry;
+    } else {
+      if (!(e & 1)) {
+        assert(e == 0);
+        page_tables.emplace_back(new page_table_t);
+        e = uintptr_t(page_tables.back().get()) | 1;
+      }
+      map_pages((page_table_t*)(e & ~uintptr_t(1)), level + 1,
+                std::max(first, entry_first), std::min(last, entry_last), entry);
+    }
+
+    if (entry_last >= last || idx == mask)
+      break;
+  }
 }
 
 void bus_t::add_device(reg_t addr, abstract_device_t* dev)
@@ -43,7 +81,23 @@ void bus_t::add_device(reg_t addr, abstract_device_t* dev)
     abort();
   }
 
-  devices[addr] = dev;
+  auto it = devices.emplace(addr, dev).first;
+
+  reg_t first_page = addr >> PGSHIFT, last_page = (addr + size - 1) >> PGSHIFT;
+  reg_t first_full = (addr + PGSIZE - 1) >> PGSHIFT;
+  if (addr + PGSIZE - 1 < addr) // device starts within the last page
+    first_full = reg_t(1) << (64 - PGSHIFT);
+  reg_t end_full = (addr + size) >> PGSHIFT; // one past the last full page
+  if (addr + size < addr + size - 1) // device ends at the top of memory
+    end_full = reg_t(1) << (64 - PGSHIFT);
+
+  auto root = page_tables[0].get();
+  if (first_full < end_full)
+    map_pages(root, 0, first_full, end_full - 1, uintptr_t(&*it));
+  if (first_page < first_full)
+    map_pages(root, 0, first_page, first_page, PAGE_SHARED);
+  if (end_full <= last_page)
+    map_pages(root, 0, last_page, last_page, PAGE_SHARED);
 }
 
 bool bus_t::load(reg_t addr, size_t len, uint8_t* bytes)
@@ -72,6 +126,30 @@ std::pair<reg_t, abstract_device_t*> bus_t::find_device(reg_t addr, size_t len)
   if (unlikely(!len || addr + len - 1 < addr))
     return std::make_pair(0, nullptr);
 
+  reg_t page = addr >> PGSHIFT;
+  if (unlikely(page != (addr + len - 1) >> PGSHIFT))
+    return find_device_slow(addr, len);
+
+  const reg_t mask = (reg_t(1) << PAGE_TABLE_BITS) - 1;
+  int shift = (PAGE_TABLE_LEVELS - 1) * PAGE_TABLE_BITS;
+  uintptr_t e = page_tables[0]->entries[(page >> shift) & mask];
+  while (e & 1) {
+    shift -= PAGE_TABLE_BITS;
+    e = ((page_table_t*)(e & ~uintptr_t(1)))->entries[(page >> shift) & mask];
+  }
+
+  if (e == 0)
+    return std::make_pair(0, fallback);
+  if (e == PAGE_SHARED)
+    return find_device_slow(addr, len);
+
+  // the device covers the whole page
+  auto [base, dev] = *(const std::pair<const reg_t, abstract_device_t*>*)e;
+  return std::make_pair(base, dev);
+}
+
+std::pair<reg_t, abstract_device_t*> bus_t::find_device_slow(reg_t addr, size_t len)
+{
   // Obtain iterator to device immediately after the one that might match
   auto it_after = devices.upper_bound(addr);
   reg_t base, size;
@@ -101,14 +179,25 @@ const std::map<reg_t, abstract_device_t*>& bus_t::get_devices() const {
 }
 
 mem_t::mem_t(reg_t size)
-  : sz(size)
+  : flat(nullptr), sz(size)
 {
   if (size == 0 || size % PGSIZE != 0)
     throw std::runtime_error("memory size must be a positive multiple of 4 KiB");
+
+  // Reserve the whole region up front; the host kernel hands out zeroed
+  // pages as they are first touched, so untouched memory costs nothing.
+  if (size <= SIZE_MAX) {
+    void* res = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (res != MAP_FAILED)
+      flat = (char*)res;
+  }
 }
 
 mem_t::~mem_t()
 {
+  if (flat)
+    munmap(flat, sz);
   for (auto& entry : sparse_memory_map)
     free(entry.second);
 }
@@ -118,6 +207,14 @@ bool mem_t::load_store(reg_t addr, size_t len, uint8_t* bytes, bool store)
   if (addr + len < addr || addr + len > sz)
     return false;
 
+  if (flat) {
+    if (store)
+      memcpy(flat + addr, bytes, len);
+    else
+      memcpy(bytes, flat + addr, len);
+    return true;
+  }
+
   while (len > 0) {
     auto n = std::min(PGSIZE - (addr % PGSIZE), reg_t(len));
 
@@ -135,6 +232,9 @@ bool mem_t::load_store(reg_t addr, size_t len, uint8_t* bytes, bool store)
 }
 
 char* mem_t::contents(reg_t addr) {
+  if (flat)
+    return flat + addr;
+
   reg_t ppn = addr >> PGSHIFT, pgoff = addr % PGSIZE;
   auto search = sparse_memory_map.find(ppn);
   if (search == sparse_memory_map.end()) {
@@ -147,7 +247,60 @@ char* mem_t::contents(reg_t addr) {
   return search->second + pgoff;
 }
 
+void abstract_mem_t::clear(reg_t addr, size_t len)
+{
+  while (len > 0) {
+    auto n = std::min(PGSIZE - (addr % PGSIZE), reg_t(len));
+    memset(contents(addr), 0, n);
+    addr += n;
+    len -= n;
+  }
+}
+
+bool mem_t::map_file(reg_t addr, size_t len, int fd, off_t offset)
+{
+  size_t pgsize = sysconf(_SC_PAGESIZE);
+  if (!flat || addr + len < addr || addr + len > sz || len == 0 ||
+      (uintptr_t)(flat + addr) % pgsize != 0 || len % pgsize != 0)
+    return false;
+
+  if (mmap(flat + addr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+           fd, offset) != MAP_FAILED)
+    return true;
+
+  // A failed MAP_FIXED may have unmapped the range, so put zero pages back
+  // for the caller to copy into.
+  if (mmap(flat + addr, len, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED)
+    throw std::bad_alloc();
+  return false;
+}
+
+// Whole host pages are replaced by fresh ones, which the host zeroes when
+// they are next touched.  As in restore(), their host addresses do not change.
+void mem_t::clear(reg_t addr, size_t len)
+{
+  size_t pgsize = sysconf(_SC_PAGESIZE);
+  if (!flat || addr + len < addr || addr + len > sz) {
+    abstract_mem_t::clear(addr, len);
+    return;
+  }
+
+  size_t head = std::min<size_t>(len, -(uintptr_t)(flat + addr) % pgsize);
+  size_t body = (len - head) / pgsize * pgsize;
+  memset(flat + addr, 0, head);
+  if (body && mmap(flat + addr + head, body, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED)
+    throw std::bad_alloc();
+  memset(flat + addr + head + body, 0, len - head - body);
+}
+
 void mem_t::dump(std::ostream& o) {
+  if (flat) {
+    o.write(flat, sz);
+    return;
+  }
+
   const char empty[PGSIZE] = {0};
   for (reg_t i = 0; i < sz; i += PGSIZE) {
     reg_t ppn = i >> PGSHIFT;
@@ -160,6 +313,81 @@ void mem_t::dump(std::ostream& o) {
   }
 }
 
+// Pages that are entirely zero are not saved, and a page whose contents
+// match a page saved earlier is saved as a reference to that page.  Each
+// record is the page's offset followed by the offset of the page holding
+// its contents; the two are equal when the contents follow inline.
+void mem_t::save(std::ostream& o)
+{
+  static const char zero_page[PGSIZE] = {0};
+  std::unordered_multimap<size_t, reg_t> saved_pages;
+
+  for (reg_t addr = 0; addr < sz; addr += PGSIZE) {
+    const char* page;
+    if (flat) {
+      page = flat + addr;
+    } else {
+      auto search = sparse_memory_map.find(addr >> PGSHIFT);
+      if (search == sparse_memory_map.end())
+        continue;
+      page = search->second;
+    }
+
+    if (memcmp(page, zero_page, PGSIZE) == 0)
+      continue;
+
+    reg_t source = addr;
+    size_t hash = std::hash<std::string_view>()(std::string_view(page, PGSIZE));
+    auto [begin, end] = saved_pages.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      if (memcmp(contents(it->second), page, PGSIZE) == 0) {
+        source = it->second;
+        break;
+      }
+    }
+
+    checkpoint_put(o, addr);
+    checkpoint_put(o, source);
+    if (source == addr) {
+      o.write(page, PGSIZE);
+      saved_pages.insert({hash, addr});
+    }
+  }
+
+  checkpoint_put(o, reg_t(-1));
+}
+
+void mem_t::restore(std::istream& i)
+{
+  // Start from all zeros.  Mapping fresh pages over a flat region keeps its
+  // host address, which TLBs and addr_to_mem() callers may still hold.
+  if (flat) {
+    if (mmap(flat, sz, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED)
+      throw std::bad_alloc();
+  } else {
+    for (auto& entry : sparse_memory_map)
+      memset(entry.second, 0, PGSIZE);
+  }
+
+  while (true) {
+    reg_t addr, source;
+    checkpoint_get(i, addr);
+    if (addr == reg_t(-1))
+      break;
+    checkpoint_get(i, source);
+    if (addr >= sz || addr % PGSIZE != 0 || source > addr || source % PGSIZE != 0)
+      throw std::runtime_error("checkpoint is corrupt");
+
+    if (source == addr) {
+      if (!i.read(contents(addr), PGSIZE))
+        throw std::runtime_error("checkpoint is truncated");
+    } else {
+      memcpy(contents(addr), contents(source), PGSIZE);
+    }
+  }
+}
+
 external_sim_device_t::external_sim_device_t(abstract_sim_if_t* sim) 
   : external_simulator(sim) {}
 
@@ -6,6 +6,7 @@
 #include "abstract_interrupt_controller.h"
 #include "platform.h"
 #include <map>
+#include <memory>
 #include <queue>
 #include <vector>
 #include <utility>
@@ -27,11 +28,28 @@ class bus_t : public abstract_device_t {
   void add_device(reg_t addr, abstract_device_t* dev);
 
   std::pair<reg_t, abstract_device_t*> find_device(reg_t addr, size_t len);
+  // find_device() by a search of the device map, without the page tables
+  std::pair<reg_t, abstract_device_t*> find_device_slow(reg_t addr, size_t len);
   const std::map<reg_t, abstract_device_t*>& get_devices() const;
 
  private:
   std::map<reg_t, abstract_device_t*> devices;
   abstract_device_t* fallback;
+
+  // A radix tree over physical page numbers, filled in by add_device(), so
+  // that find_device() takes a few array lookups.  An entry is 0 if no
+  // device is mapped there, a pointer to the node of devices covering it
+  // entirely, PAGE_SHARED if it is a page only partly covered by devices,
+  // or a pointer to the next level's table with its low bit set.
+  // Subtrees wholly covered by one device end early.
+  static const int PAGE_TABLE_BITS = 13;
+  static const int PAGE_TABLE_LEVELS = 4; // covers 64 - PGSHIFT bits
+  static const uintptr_t PAGE_SHARED = 2;
+  struct page_table_t {
+    uintptr_t entries[1 << PAGE_TABLE_BITS] = {};
+  };
+  std::vector<std::unique_ptr<page_table_t>> page_tables;
+  void map_pages(page_table_t* table, int level, reg_t first, reg_t last, uintptr_t entry);
 };
 
 class rom_device_t : public abstract_device_t {
@@ -51,6 +69,15 @@ class abstract_mem_t : public abstract_device_t {
 
   virtual char* contents(reg_t addr) = 0;
   virtual void dump(std::ostream& o) = 0;
+
+  // If the whole memory is one contiguous host buffer, return its base so
+  // that addresses can be translated by offset alone; otherwise nullptr.
+  virtual char* flat_contents() { return nullptr; }
+
+  // Map len bytes of fd from offset over [addr, addr + len), copy-on-write,
+  // and return true, or return false if this memory cannot.
+  virtual bool map_file(reg_t UNUSED addr, size_t UNUSED len, int UNUSED fd, off_t UNUSED offset) { return false; }
+  virtual void clear(reg_t addr, size_t len);
 };
 
 class mem_t : public abstract_mem_t {
@@ -62,12 +89,20 @@ class mem_t : public abstract_mem_t {
   bool load(reg_t addr, size_t len, uint8_t* bytes) override { return load_store(addr, len, bytes, false); }
   bool store(reg_t addr, size_t len, const uint8_t* bytes) override { return load_store(addr, len, const_cast<uint8_t*>(bytes), true); }
   char* contents(reg_t addr) override;
+  char* flat_contents() override { return flat; }
+  bool map_file(reg_t addr, size_t len, int fd, off_t offset) override;
+  void clear(reg_t addr, size_t len) override;
   reg_t size() override { return sz; }
   void dump(std::ostream& o) override;
+  void save(std::ostream& o) override;
+  void restore(std::istream& i) override;
 
  private:
   bool load_store(reg_t addr, size_t len, uint8_t* bytes, bool store);
 
+  // one MAP_NORESERVE mapping of the whole region, or nullptr if the host
+  // could not provide it, in which case pages are allocated on demand
+  char* flat;
   std::map<reg_t, char*> sparse_memory_map;
   reg_t sz;
 };
@@ -98,6 +133,9 @@ class clint_t : public abstract_device_t {
   bool store(reg_t addr, size_t len, const uint8_t* bytes) override;
   reg_t size() override { return CLINT_SIZE; }
   void tick(reg_t rtc_ticks) override;
+  reg_t next_event() override;
+  void save(std::ostream& o) override;
+  void restore(std::istream& i) override;
   uint64_t get_mtimecmp(reg_t hartid) { return mtimecmp[hartid]; }
   uint64_t get_mtime() { return mtime; }
  private:
@@ -114,6 +152,7 @@ class clint_t : public abstract_device_t {
 };
 
 #define PLIC_MAX_DEVICES 1024
+#define PLIC_PRIO_LEVELS (1 << PLIC_PRIO_BITS)
 
 struct plic_context_t {
   plic_context_t(processor_t* proc, bool mmode)
@@ -128,6 +167,13 @@ struct plic_context_t {
   uint32_t pending[PLIC_MAX_DEVICES/32] {};
   uint8_t pending_priority[PLIC_MAX_DEVICES] {};
   uint32_t claimed[PLIC_MAX_DEVICES/32] {};
+
+  // The sources that are pending and not claimed, by pending_priority, with
+  // a bit per nonzero word of each level and a bit per nonempty level, so
+  // that the best of them is found in a few steps rather than by a scan.
+  uint32_t active[PLIC_PRIO_LEVELS][PLIC_MAX_DEVICES/32] {};
+  uint32_t active_words[PLIC_PRIO_LEVELS] {};
+  uint32_t active_levels {};
 };
 
 class plic_t : public abstract_device_t, public abstract_interrupt_controller_t {
@@ -137,6 +183,8 @@ class plic_t : public abstract_device_t, public abstract_interrupt_controller_t
   bool store(reg_t addr, size_t len, const uint8_t* bytes) override;
   void set_interrupt_level(uint32_t id, int lvl) override;
   reg_t size() override { return PLIC_SIZE; }
+  void save(std::ostream& o) override;
+  void restore(std::istream& i) override;
  private:
   std::vector<plic_context_t> contexts;
   uint32_t num_ids;
@@ -144,6 +192,12 @@ class plic_t : public abstract_device_t, public abstract_interrupt_controller_t
   uint32_t max_prio;
   uint8_t priority[PLIC_MAX_DEVICES];
   uint32_t level[PLIC_MAX_DEVICES/32];
+  // the first context with each source enabled, or contexts.size() if none,
+  // which is the one set_interrupt_level() delivers it to
+  std::vector<uint32_t> first_enabled;
+  void update_first_enabled(uint32_t id_word);
+  void context_file(plic_context_t *c, uint32_t id, bool active);
+  void context_refile(plic_context_t *c, uint32_t id);
   uint32_t context_best_pending(const plic_context_t *c);
   void context_update(const plic_context_t *context);
   uint32_t context_claim(plic_context_t *c);
@@ -168,6 +222,8 @@ class ns16550_t : public abstract_device_t {
   bool store(reg_t addr, size_t len, const uint8_t* bytes) override;
   void tick(reg_t rtc_ticks) override;
   reg_t size() override { return NS16550_SIZE; }
+  void save(std::ostream& o) override;
+  void restore(std::istream& i) override;
  private:
   abstract_interrupt_controller_t *intctrl;
   uint32_t interrupt_id;
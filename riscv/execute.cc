@@ -5,6 +5,8 @@
 #include "mmu.h"
 #include "disasm.h"
 #include "decode_macros.h"
+#include "arith.h"
+#include "commit_log.h"
 #include <cassert>
 
 static void commit_log_reset(processor_t* p)
@@ -22,45 +24,80 @@ static void commit_log_stash_privilege(processor_t* p)
   state->last_inst_flen = p->get_flen();
 }
 
-static void commit_log_print_value(FILE *log_file, int width, const void *data)
+// binary counterpart of commit_log_print_insn; see commit_log.h
+static void commit_log_encode_insn(processor_t *p, commit_log_encoder_t *enc, reg_t pc, insn_t insn)
 {
-  assert(log_file);
+  auto& reg = p->get_state()->log_reg_write;
+  auto& load = p->get_state()->log_mem_read;
+  auto& store = p->get_state()->log_mem_write;
+  int priv = p->get_state()->last_inst_priv;
+  int xlen = p->get_state()->last_inst_xlen;
+  int flen = p->get_state()->last_inst_flen;
+  reg_t xlen_mask = xlen == 64 ? reg_t(-1) : reg_t(uint32_t(-1));
 
-  switch (width) {
-    case 8:
-      fprintf(log_file, "0x%02" PRIx8, *(const uint8_t *)data);
-      break;
-    case 16:
-      fprintf(log_file, "0x%04" PRIx16, *(const uint16_t *)data);
+  size_t nreg = 0;
+  bool has_vec = false;
+  for (auto item : reg) {
+    if (item.first == 0)
+      continue;
+    nreg++;
+    has_vec |= (item.first & 0xf) == 2 || (item.first & 0xf) == 3;
+  }
+
+  int flen_code = flen ? ctz(flen) - 3 : 0;
+  enc->put_u8(COMMIT_LOG_INSN);
+  enc->put_u8(priv | (xlen == 64) << 2 | flen_code << 3 | has_vec << 6);
+  enc->put_svarint(pc - enc->next_pc);
+  uint64_t bits = insn.bits();
+  enc->put_bytes(&bits, insn.length());
+  enc->next_pc = pc + insn.length();
+
+  if (has_vec) {
+    enc->put_varint(p->VU.VLEN);
+    enc->put_varint(p->VU.vsew);
+    enc->put_svarint(p->VU.vflmul < 1 ? -(int64_t)(1 / p->VU.vflmul) : (int64_t)p->VU.vflmul);
+    enc->put_varint(p->VU.vl->read());
+  }
+
+  enc->put_varint(nreg);
+  for (auto item : reg) {
+    if (item.first == 0)
+      continue;
+
+    enc->put_varint(item.first);
+    switch (item.first & 0xf) {
+    case 0:
+    case 4:
+      enc->put_varint(item.second.v[0] & xlen_mask);
       break;
-    case 32:
-      fprintf(log_file, "0x%08" PRIx32, *(const uint32_t *)data);
+    case 1:
+      enc->put_bytes(item.second.v, flen / 8);
       break;
-    case 64:
-      fprintf(log_file, "0x%016" PRIx64, *(const uint64_t *)data);
+    case 2:
+      enc->put_bytes(&p->VU.elt<uint8_t>(item.first >> 4, 0), p->VU.vlenb);
       break;
-    default:
-      if (width % 8 == 0) {
-        const uint8_t *arr = (const uint8_t *)data;
+    }
+  }
 
-        fprintf(log_file, "0x");
-        for (int idx = width / 8 - 1; idx >= 0; --idx) {
-          fprintf(log_file, "%02" PRIx8, arr[idx]);
-        }
-      } else {
-        abort();
-      }
-      break;
+  enc->put_varint(load.size());
+  for (auto item : load)
+    enc->put_varint(std::get<0>(item) & xlen_mask);
+
+  enc->put_varint(store.size());
+  for (auto item : store) {
+    enc->put_varint(std::get<0>(item) & xlen_mask);
+    enc->put_u8(std::get<2>(item));
+    enc->put_varint(std::get<1>(item));
   }
-}
 
-static void commit_log_print_value(FILE *log_file, int width, uint64_t val)
-{
-  commit_log_print_value(log_file, width, &val);
+  enc->end_record();
 }
 
 static void commit_log_print_insn(processor_t *p, reg_t pc, insn_t insn)
 {
+  if (auto enc = p->get_commit_log_encoder())
+    return commit_log_encode_insn(p, enc, pc, insn);
+
   FILE *log_file = p->get_log_file();
 
   auto& reg = p->get_state()->log_reg_write;
@@ -70,6 +107,9 @@ static void commit_log_print_insn(processor_t *p, reg_t pc, insn_t insn)
   int xlen = p->get_state()->last_inst_xlen;
   int flen = p->get_state()->last_inst_flen;
 
+  // keep each line in one piece when harts run on separate threads
+  flockfile(log_file);
+
   // print core id on all lines so it is easy to grep
   fprintf(log_file, "core%4" PRId32 ": ", p->get_id());
 
@@ -148,6 +188,8 @@ static void commit_log_print_insn(processor_t *p, reg_t pc, insn_t insn)
     commit_log_print_value(log_file, std::get<2>(item) << 3, std::get<1>(item));
   }
   fprintf(log_file, "\n");
+
+  funlockfile(log_file);
 }
 
 inline void processor_t::update_histogram(reg_t pc)
@@ -301,22 +343,20 @@ void processor_t::step(size_t n)
       }
       else while (instret < n)
       {
-        // Main simulation loop, fast path.
-        for (auto ic_entry = _mmu->access_icache(pc); instret < n; instret++) {
-          auto fetch = ic_entry->data;
-          ic_entry = ic_entry->next;
-          auto new_pc = execute_insn_fast(this, pc, fetch);
-          if (unlikely(ic_entry->tag != new_pc)) {
-            ic_entry = &_mmu->icache[_mmu->icache_index(new_pc)];
-            _mmu->icache[_mmu->icache_index(pc)].next = ic_entry;
-            if (ic_entry->tag != new_pc) {
-              pc = new_pc;
-              advance_pc();
-              break;
-            }
-          }
-          state.pc = pc = ic_entry->tag;
+        // Main simulation loop, fast path.  Run a cached straight-line block
+        // to its end, or until an instruction flushes the I$.  Only the last
+        // instruction can branch or serialize, so only its pc is checked.
+        auto bb = _mmu->access_bb_cache(pc);
+        _mmu->bb_end = std::min<reg_t>(bb->length, n - instret);
+        for (size_t i = 0; ; ) {
+          _mmu->observe_fetch(pc, bb->insns[i].insn);
+          pc = execute_insn_fast(this, pc, bb->insns[i]);
+          if (++i >= _mmu->bb_end)
+            break;
+          state.pc = pc;
+          instret++;
         }
+        advance_pc();
       }
     }
     catch(trap_t& t)
@@ -371,4 +411,9 @@ serialize:
 
     n -= instret;
   }
+
+  // hand this quantum's records to the writer, so that harts' records are
+  // interleaved in the file as they would be in the text log
+  if (unlikely(commit_log_encoder != nullptr))
+    commit_log_encoder->flush();
 }
@@ -0,0 +1,90 @@
+// See LICENSE for license details.
+#ifndef _RISCV_HART_THREADS_H
+#define _RISCV_HART_THREADS_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A pool of host threads, one per hart, used by sim_t when harts run in
+// parallel.  run() hands the same job to every thread, runs index 0 on the
+// calling thread, and returns once all of them are done, so each call ends
+// at a barrier.  Quanta are short, so idle threads spin (yielding) instead
+// of sleeping on a condition variable.
+class hart_threads_t
+{
+public:
+  hart_threads_t(size_t n) : generation(0), pending(0), exiting(false)
+  {
+    for (size_t i = 1; i < n; i++)
+      threads.emplace_back([this, i] { thread_main(i); });
+  }
+
+  ~hart_threads_t()
+  {
+    exiting.store(true, std::memory_order_release);
+    for (auto& t : threads)
+      t.join();
+  }
+
+  // Run fn(i) for every i in [0, n) and wait for all of them.  The first
+  // exception thrown by any fn is rethrown here.
+  void run(const std::function<void(size_t)>& fn)
+  {
+    job = &fn;
+    pending.store(threads.size(), std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+
+    run_job(0);
+
+    while (pending.load(std::memory_order_acquire) != 0)
+      std::this_thread::yield();
+
+    if (error) {
+      auto e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  void run_job(size_t i)
+  {
+    try {
+      (*job)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+
+  void thread_main(size_t i)
+  {
+    size_t seen = 0;
+    while (true) {
+      size_t g;
+      while ((g = generation.load(std::memory_order_acquire)) == seen) {
+        if (exiting.load(std::memory_order_acquire))
+          return;
+        std::this_thread::yield();
+      }
+      seen = g;
+      run_job(i);
+      pending.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  std::vector<std::thread> threads;
+  const std::function<void(size_t)>* job;
+  std::atomic<size_t> generation;
+  std::atomic<size_t> pending;
+  std::atomic<bool> exiting;
+  std::mutex error_lock;
+  std::exception_ptr error;
+};
+
+#endif
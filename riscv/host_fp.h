@@ -0,0 +1,261 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_HOST_FP_H
+#define _RISCV_HOST_FP_H
+
+// Scalar F and D arithmetic on the host FPU.  In round-to-nearest-even an
+// IEEE 754 host gives the same results as softfloat, and the exception flags
+// follow from the operands, the result and the exact rounding error, which
+// std::fma() and two-sum recover.  (Reading the flags back from the host's
+// status register would need a write to clear it first, which stalls the
+// host FPU for longer than softfloat takes.)
+//
+// Everything else is left to softfloat: other rounding modes, NaN operands
+// and results, since RISC-V returns the canonical NaN and must notice
+// signaling NaNs, and operands or results so close to the subnormal range
+// that the rounding error might not be representable.
+
+#include "softfloat.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if FLT_EVAL_METHOD == 0
+#define HOST_FP_SUPPORTED (std::numeric_limits<float>::is_iec559 && \
+                           std::numeric_limits<double>::is_iec559)
+#else
+#define HOST_FP_SUPPORTED false
+#endif
+
+// 2^(emin + 2p - 2): products and quotients of numbers at least this large
+// have representable rounding errors.
+template<typename H>
+static constexpr H host_fp_tiny = std::numeric_limits<H>::min() /
+  std::numeric_limits<H>::epsilon() / std::numeric_limits<H>::epsilon();
+
+// zero, infinite, or a number no smaller than host_fp_tiny; NaNs fail
+template<typename H>
+static inline bool host_fp_ordinary(H x)
+{
+  H m = std::fabs(x);
+  return m == 0 || m >= host_fp_tiny<H>;
+}
+
+template<typename H, typename T>
+static inline H host_fp_from(T x)
+{
+  H h;
+  static_assert(sizeof(h) == sizeof(x.v));
+  memcpy(&h, &x.v, sizeof(h));
+  return h;
+}
+
+template<typename T, typename H>
+static inline bool host_fp_result(T& res, H r, bool inexact)
+{
+  memcpy(&res.v, &r, sizeof(r));
+  if (inexact)
+    softfloat_exceptionFlags |= softfloat_flag_inexact;
+  return true;
+}
+
+template<typename T, typename H>
+static inline bool host_fp_overflow(T& res, H r)
+{
+  softfloat_exceptionFlags |= softfloat_flag_overflow;
+  return host_fp_result(res, r, true);
+}
+
+static inline bool host_fp_usable()
+{
+  return HOST_FP_SUPPORTED && softfloat_roundingMode == softfloat_round_near_even;
+}
+
+template<typename T, typename H>
+static inline bool host_fp_add(T& res, H x, H y)
+{
+  H r = x + y;
+  if (!host_fp_ordinary(x) || !host_fp_ordinary(y) || !host_fp_ordinary(r))
+    return false;
+  if (std::isinf(r))
+    return std::isinf(x) || std::isinf(y) ? host_fp_result(res, r, false) : host_fp_overflow(res, r);
+
+  H yy = r - x;
+  H err = (x - (r - yy)) + (y - yy);
+  return host_fp_result(res, r, err != 0);
+}
+
+template<typename T, typename H>
+static inline bool host_fp_mul(T& res, H x, H y)
+{
+  H r = x * y;
+  if (!host_fp_ordinary(x) || !host_fp_ordinary(y) || !host_fp_ordinary(r))
+    return false;
+  if (std::isinf(r))
+    return std::isinf(x) || std::isinf(y) ? host_fp_result(res, r, false) : host_fp_overflow(res, r);
+  if (r == 0)
+    return (x == 0 || y == 0) && host_fp_result(res, r, false);
+
+  return host_fp_result(res, r, std::fma(x, y, -r) != 0);
+}
+
+template<typename T, typename H>
+static inline bool host_fp_div(T& res, H x, H y)
+{
+  H r = x / y;
+  if (!host_fp_ordinary(x) || !host_fp_ordinary(y) || !host_fp_ordinary(r))
+    return false;
+  if (y == 0) {
+    if (!std::isinf(x))
+      softfloat_exceptionFlags |= softfloat_flag_infinite;
+    return host_fp_result(res, r, false);
+  }
+  if (std::isinf(r))
+    return std::isinf(x) ? host_fp_result(res, r, false) : host_fp_overflow(res, r);
+  if (r == 0)
+    return (x == 0 || std::isinf(y)) && host_fp_result(res, r, false);
+
+  return host_fp_result(res, r, std::fma(-r, y, x) != 0);
+}
+
+template<typename T, typename H>
+static inline bool host_fp_sqrt(T& res, H x)
+{
+  H r = std::sqrt(x);
+  if (!host_fp_ordinary(x) || !host_fp_ordinary(r))
+    return false;
+  if (r == 0 || std::isinf(r))
+    return host_fp_result(res, r, false);
+
+  return host_fp_result(res, r, std::fma(-r, r, x) != 0);
+}
+
+// The error of an FMA is computed as in Boldo and Muller, "Exact and
+// Approximated Error of the FMA", IEEE Trans. Computers 60(2), 2011.
+template<typename T, typename H>
+static inline bool host_fp_mulAdd(T& res, H x, H y, H z)
+{
+  H r = std::fma(x, y, z);
+  if (!host_fp_ordinary(x) || !host_fp_ordinary(y) || !host_fp_ordinary(z) || !host_fp_ordinary(r))
+    return false;
+  if (std::isinf(x) || std::isinf(y) || std::isinf(z))
+    return host_fp_result(res, r, false);
+  if (std::isinf(r))
+    return host_fp_overflow(res, r);
+  if (x == 0 || y == 0)
+    return host_fp_result(res, r, false);
+
+  // volatile, lest the compiler contract u1 + alpha1 below into an FMA
+  volatile H u1_product = x * y;
+  H u1 = u1_product;
+  if (u1 == 0 || !host_fp_ordinary(u1) || std::isinf(u1))
+    return false;
+  H u2 = std::fma(x, y, -u1);
+  H alpha1 = z + u2;
+  H zz = alpha1 - z;
+  H z2 = (z - (alpha1 - zz)) + (u2 - zz);
+  H beta1 = u1 + alpha1;
+  H bb = beta1 - u1;
+  H beta2 = (u1 - (beta1 - bb)) + (alpha1 - bb);
+  H gamma = (beta1 - r) + beta2;
+  return host_fp_result(res, r, gamma + z2 != 0);
+}
+
+static inline float32_t host_f32_add(float32_t a, float32_t b)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_add(res, host_fp_from<float>(a), host_fp_from<float>(b)))
+    return res;
+  return f32_add(a, b);
+}
+
+static inline float32_t host_f32_sub(float32_t a, float32_t b)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_add(res, host_fp_from<float>(a), -host_fp_from<float>(b)))
+    return res;
+  return f32_sub(a, b);
+}
+
+static inline float32_t host_f32_mul(float32_t a, float32_t b)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_mul(res, host_fp_from<float>(a), host_fp_from<float>(b)))
+    return res;
+  return f32_mul(a, b);
+}
+
+static inline float32_t host_f32_div(float32_t a, float32_t b)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_div(res, host_fp_from<float>(a), host_fp_from<float>(b)))
+    return res;
+  return f32_div(a, b);
+}
+
+static inline float32_t host_f32_sqrt(float32_t a)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_sqrt(res, host_fp_from<float>(a)))
+    return res;
+  return f32_sqrt(a);
+}
+
+static inline float32_t host_f32_mulAdd(float32_t a, float32_t b, float32_t c)
+{
+  float32_t res;
+  if (host_fp_usable() && host_fp_mulAdd(res, host_fp_from<float>(a), host_fp_from<float>(b), host_fp_from<float>(c)))
+    return res;
+  return f32_mulAdd(a, b, c);
+}
+
+static inline float64_t host_f64_add(float64_t a, float64_t b)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_add(res, host_fp_from<double>(a), host_fp_from<double>(b)))
+    return res;
+  return f64_add(a, b);
+}
+
+static inline float64_t host_f64_sub(float64_t a, float64_t b)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_add(res, host_fp_from<double>(a), -host_fp_from<double>(b)))
+    return res;
+  return f64_sub(a, b);
+}
+
+static inline float64_t host_f64_mul(float64_t a, float64_t b)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_mul(res, host_fp_from<double>(a), host_fp_from<double>(b)))
+    return res;
+  return f64_mul(a, b);
+}
+
+static inline float64_t host_f64_div(float64_t a, float64_t b)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_div(res, host_fp_from<double>(a), host_fp_from<double>(b)))
+    return res;
+  return f64_div(a, b);
+}
+
+static inline float64_t host_f64_sqrt(float64_t a)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_sqrt(res, host_fp_from<double>(a)))
+    return res;
+  return f64_sqrt(a);
+}
+
+static inline float64_t host_f64_mulAdd(float64_t a, float64_t b, float64_t c)
+{
+  float64_t res;
+  if (host_fp_usable() && host_fp_mulAdd(res, host_fp_from<double>(a), host_fp_from<double>(b), host_fp_from<double>(c)))
+    return res;
+  return f64_mulAdd(a, b, c);
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include "host_fp.h"
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+#include <random>
+
+// Checks that the host_* operations used by --host-fp give the same results
+// and exception flags as softfloat in every rounding mode, on random
+// operands weighted towards zeros, infinities, NaNs, the edges of the
+// subnormal range and the largest finite numbers.
+
+static std::mt19937_64 rng(1);
+
+static uint32_t random_f32()
+{
+  static const uint32_t special[] = {
+    0x00000000, 0x80000000, 0x7f800000, 0xff800000, 0x7fc00000, 0x7f800001,
+    0x3f800000, 0x00800000, 0x7f7fffff, 0x00000001, 0x1f800000, 0x20000000,
+  };
+  uint32_t v = rng();
+  unsigned k = rng() % 16;
+  if (k < std::size(special))
+    return special[k] ^ (rng() % 4);
+  if (k < 14) // exponents near the middle, where the host path is taken
+    return (v & 0x807fffff) | uint32_t(100 + rng() % 56) << 23;
+  return v;
+}
+
+static uint64_t random_f64()
+{
+  static const uint64_t special[] = {
+    0x0000000000000000, 0x8000000000000000, 0x7ff0000000000000, 0xfff0000000000000,
+    0x7ff8000000000000, 0x7ff0000000000001, 0x3ff0000000000000, 0x0010000000000000,
+    0x7fefffffffffffff, 0x0000000000000001, 0x1ff0000000000000, 0x2000000000000000,
+  };
+  uint64_t v = rng();
+  unsigned k = rng() % 16;
+  if (k < std::size(special))
+    return special[k] ^ (rng() % 4);
+  if (k < 14)
+    return (v & 0x800fffffffffffff) | uint64_t(900 + rng() % 250) << 52;
+  return v;
+}
+
+static int failures = 0;
+
+template<typename T, typename Host, typename Soft>
+static void check(const char* name, Host host, Soft soft)
+{
+  softfloat_exceptionFlags = 0;
+  T host_res = host();
+  uint_fast8_t host_flags = softfloat_exceptionFlags;
+
+  softfloat_exceptionFlags = 0;
+  T soft_res = soft();
+  uint_fast8_t soft_flags = softfloat_exceptionFlags;
+
+  if (host_res.v != soft_res.v || host_flags != soft_flags) {
+    if (failures++ < 20)
+      fprintf(stderr, "%s in rounding mode %d: host gives %" PRIx64 " with flags %x, softfloat %" PRIx64 " with flags %x\n",
+              name, int(softfloat_roundingMode), uint64_t(host_res.v), unsigned(host_flags),
+              uint64_t(soft_res.v), unsigned(soft_flags));
+  }
+}
+
+int main()
+{
+  static const uint_fast8_t modes[] = {
+    softfloat_round_near_even, softfloat_round_minMag, softfloat_round_min,
+    softfloat_round_max, softfloat_round_near_maxMag,
+  };
+
+  for (auto mode : modes) {
+    softfloat_roundingMode = mode;
+    for (int i = 0; i < 200000; i++) {
+      float32_t a{random_f32()}, b{random_f32()}, c{random_f32()};
+      check<float32_t>("f32_add", [&] { return host_f32_add(a, b); }, [&] { return f32_add(a, b); });
+      check<float32_t>("f32_sub", [&] { return host_f32_sub(a, b); }, [&] { return f32_sub(a, b); });
+      check<float32_t>("f32_mul", [&] { return host_f32_mul(a, b); }, [&] { return f32_mul(a, b); });
+      check<float32_t>("f32_div", [&] { return host_f32_div(a, b); }, [&] { return f32_div(a, b); });
+      check<float32_t>("f32_sqrt", [&] { return host_f32_sqrt(a); }, [&] { return f32_sqrt(a); });
+      check<float32_t>("f32_mulAdd", [&] { return host_f32_mulAdd(a, b, c); }, [&] { return f32_mulAdd(a, b, c); });
+
+      float64_t x{random_f64()}, y{random_f64()}, z{random_f64()};
+      check<float64_t>("f64_add", [&] { return host_f64_add(x, y); }, [&] { return f64_add(x, y); });
+      check<float64_t>("f64_sub", [&] { return host_f64_sub(x, y); }, [&] { return f64_sub(x, y); });
+      check<float64_t>("f64_mul", [&] { return host_f64_mul(x, y); }, [&] { return f64_mul(x, y); });
+      check<float64_t>("f64_div", [&] { return host_f64_div(x, y); }, [&] { return f64_div(x, y); });
+      check<float64_t>("f64_sqrt", [&] { return host_f64_sqrt(x); }, [&] { return f64_sqrt(x); });
+      check<float64_t>("f64_mulAdd", [&] { return host_f64_mulAdd(x, y, z); }, [&] { return f64_mulAdd(x, y, z); });
+    }
+  }
+
+  if (failures)
+    fprintf(stderr, "%d mismatches between host and softfloat arithmetic\n", failures);
+  return failures != 0;
+}
@@ -4,6 +4,7 @@
 #include "arith.h"
 #include "mmu.h"
 #include "softfloat.h"
+#include "host_fp.h"
 #include "internals.h"
 #include "specialize.h"
 #include "tracer.h"
@@ -1,4 +1,4 @@
 require_extension('H');
 require_novirt();
 require_privilege(get_field(STATE.mstatus->read(), MSTATUS_TVM) ? PRV_M : PRV_S);
-MMU.flush_tlb();
+MMU.flush_tlb_gvma(insn.rs2() ? std::optional<reg_t>(RS2) : std::nullopt);
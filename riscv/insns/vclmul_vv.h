@@ -10,11 +10,6 @@ VI_VV_ULOOP
   // Perform a carryless multiplication 64bx64b on each 64b element,
   // return the low 64b of the 128b product.
   //   <https://en.wikipedia.org/wiki/Carry-less_product>
-  vd = 0;
-  for (std::size_t bit_idx = 0; bit_idx < sew; ++bit_idx) {
-    const reg_t mask = ((reg_t) 1) << bit_idx;
-    if ((vs1 & mask) != 0) {
-      vd ^= vs2 << bit_idx;
-    }
-  }
+  uint64_t UNUSED hi;
+  ZVK_CLMUL64(vs2, vs1, vd, hi);
 })
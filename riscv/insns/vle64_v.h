@@ -1,2 +1,2 @@
 // vle64.v and vlseg[2-8]e64.v
-VI_LD(0, (i * nf + fn), int64, false);
+VI_LD_UNIT_STRIDE(int64, false);
@@ -2,6 +2,7 @@
 
 #include "config.h"
 #include "mmu.h"
+#include "abstract_device.h"
 #include "arith.h"
 #include "memif.h"
 #include "simif.h"
@@ -12,8 +13,16 @@
 
 #include <cassert>
 
+store_seq_t mmu_t::store_seqs[mmu_t::STORE_SEQ_ENTRIES];
+
 mmu_t::mmu_t(simif_t* sim, endianness_t endianness, processor_t* proc, reg_t cache_blocksz)
- : sim(sim), proc(proc), blocksz(cache_blocksz),
+ : sim(sim), proc(proc), held_store_seq(nullptr),
+  parallel_harts(sim->get_cfg().parallel_harts),
+  blocksz(cache_blocksz),
+  tlb_contexts(), tlb_context_victim(0), tlb_context_generation(0),
+  l2_tlb_sets(sim->get_cfg().tlb_entries / L2_TLB_WAYS), l2_tlb_victim(0),
+  l2_tlb(l2_tlb_sets * L2_TLB_WAYS),
+  superpage_tlb(), superpage_tlb_victim(0),
 #ifdef RISCV_ENABLE_DUAL_ENDIAN
   target_big_endian(endianness == endianness_big),
 #endif
@@ -21,6 +30,8 @@ mmu_t::mmu_t(simif_t* sim, endianness_t endianness, processor_t* proc, reg_t cac
   check_triggers_load(false),
   check_triggers_store(false)
 {
+  bb_end = 0;
+  memset(mmio_tlb, -1, sizeof(mmio_tlb));
 #ifndef RISCV_ENABLE_DUAL_ENDIAN
   assert(endianness == endianness_little);
 #endif
@@ -36,18 +47,215 @@ void mmu_t::flush_icache()
 {
   for (size_t i = 0; i < ICACHE_ENTRIES; i++)
     icache[i].tag = -1;
+
+  for (size_t i = 0; i < BB_CACHE_ENTRIES; i++)
+    bb_cache[i].tag = -1;
+
+  // The flush may come from inside the block being executed (e.g. a store
+  // to code under Ziccid), so make it end after this instruction.
+  bb_end = 0;
 }
 
 void mmu_t::flush_tlb()
+{
+  for (auto& ctx : tlb_contexts)
+    ctx.id = 0;
+
+  flush_walk_cache();
+  flush_tlb_context();
+}
+
+void mmu_t::flush_tlb_context()
 {
   memset(tlb_insn, -1, sizeof(tlb_insn));
   memset(tlb_load, -1, sizeof(tlb_load));
   memset(tlb_store, -1, sizeof(tlb_store));
-  memset(pte_cache, -1, sizeof(pte_cache));
+  tlb_context = 0;
 
   flush_icache();
 }
 
+void mmu_t::flush_tlb_vma(bool virt, std::optional<reg_t> vaddr, std::optional<reg_t> asid)
+{
+  flush_walk_cache();
+  flush_tlb_context();
+  if (!proc)
+    return;
+
+  bool rv32 = proc->get_const_xlen() == 32;
+  reg_t asid_mask = get_field(reg_t(-1), rv32 ? SATP32_ASID : SATP64_ASID);
+  reg_t vmid = get_field(proc->get_state()->hgatp->read(), rv32 ? HGATP32_VMID : HGATP64_VMID);
+
+  uint64_t matches = 0;
+  for (size_t i = 0; i < TLB_CONTEXTS; i++) {
+    auto& ctx = tlb_contexts[i];
+    if (!ctx.id || ctx.virt != virt || (virt && ctx.vmid != vmid) ||
+        (asid && ctx.asid != (*asid & asid_mask)))
+      continue;
+
+    if (vaddr)
+      matches |= uint64_t(1) << i;
+    else
+      ctx.id = 0;
+  }
+
+  if (!matches)
+    return;
+
+  auto matching = [&](reg_t ctx) {
+    return ctx && tlb_contexts[ctx % TLB_CONTEXTS].id == ctx &&
+           ((matches >> (ctx % TLB_CONTEXTS)) & 1);
+  };
+
+  for (auto& entry : superpage_tlb) {
+    if ((*vaddr & ~entry.mask) == entry.vbase && matching(entry.ctx))
+      entry.ctx = 0;
+  }
+
+  if (l2_tlb.empty())
+    return;
+
+  reg_t vpn = *vaddr >> PGSHIFT;
+  auto set = &l2_tlb[(vpn % l2_tlb_sets) * L2_TLB_WAYS];
+  for (size_t i = 0; i < L2_TLB_WAYS; i++) {
+    if (set[i].vpn == vpn && matching(set[i].ctx))
+      set[i].ctx = 0;
+  }
+}
+
+void mmu_t::flush_tlb_gvma(std::optional<reg_t> vmid)
+{
+  flush_walk_cache();
+  flush_tlb_context();
+  if (!proc)
+    return;
+
+  reg_t vmid_mask = get_field(reg_t(-1), proc->get_const_xlen() == 32 ? HGATP32_VMID : HGATP64_VMID);
+  for (auto& ctx : tlb_contexts) {
+    if (ctx.virt && (!vmid || ctx.vmid == (*vmid & vmid_mask)))
+      ctx.id = 0;
+  }
+}
+
+void mmu_t::flush_walk_cache()
+{
+  memset(walk_cache, -1, sizeof(walk_cache));
+}
+
+int mmu_t::walk_cache_lookup(bool g_stage, reg_t atp, reg_t hgatp, reg_t addr, int levels, int idxbits, reg_t& base)
+{
+  for (int i = 1; i < levels; i++) {
+    reg_t prefix = addr >> (PGSHIFT + i * idxbits);
+    auto& entry = walk_cache[g_stage][i][prefix % WALK_CACHE_ENTRIES];
+    if (entry.atp == atp && entry.hgatp == hgatp && entry.prefix == prefix) {
+      base = entry.base;
+      return i - 1;
+    }
+  }
+
+  return levels - 1;
+}
+
+void mmu_t::walk_cache_insert(bool g_stage, reg_t atp, reg_t hgatp, reg_t addr, int level, int idxbits, reg_t base)
+{
+  reg_t prefix = addr >> (PGSHIFT + level * idxbits);
+  walk_cache[g_stage][level][prefix % WALK_CACHE_ENTRIES] = {atp, hgatp, prefix, base};
+}
+
+reg_t mmu_t::current_tlb_context()
+{
+  if (likely(tlb_context))
+    return tlb_context;
+
+  auto state = proc->get_state();
+  bool virt = state->v;
+  const reg_t status_mask = MSTATUS_SUM | MSTATUS_MXR;
+  decltype(tlb_context_t::key) key = {
+    state->prv, virt, proc->get_xlen(),
+    state->satp->readvirt(false), state->vsatp->read(), state->hgatp->read(),
+    state->mstatus->read() & status_mask, state->vsstatus->read() & status_mask,
+    state->menvcfg->read(), state->henvcfg->read(), state->senvcfg->read(),
+  };
+
+  for (auto& ctx : tlb_contexts) {
+    if (ctx.id && ctx.key == key)
+      return tlb_context = ctx.id;
+  }
+
+  // Not live, so take a free slot if there is one, or else retire the
+  // context in the next slot in turn.
+  size_t slot = tlb_context_victim;
+  for (size_t i = 0; i < TLB_CONTEXTS; i++) {
+    if (!tlb_contexts[i].id) {
+      slot = i;
+      break;
+    }
+  }
+  tlb_context_victim = (slot + 1) % TLB_CONTEXTS;
+
+  bool rv32 = proc->get_const_xlen() == 32;
+  auto& ctx = tlb_contexts[slot];
+  ctx.key = key;
+  ctx.virt = virt;
+  ctx.asid = get_field(virt ? state->vsatp->read() : state->satp->readvirt(false), rv32 ? SATP32_ASID : SATP64_ASID);
+  ctx.vmid = get_field(state->hgatp->read(), rv32 ? HGATP32_VMID : HGATP64_VMID);
+  ctx.id = ++tlb_context_generation * TLB_CONTEXTS + slot;
+  return tlb_context = ctx.id;
+}
+
+std::tuple<bool, uintptr_t, reg_t> mmu_t::access_l2_tlb(reg_t vaddr, access_type type)
+{
+  // Ziccid keeps the instruction and store TLBs of all harts exclusive, which
+  // refills from here would bypass.
+  if (!proc || in_mprv() || proc->get_log_commits_enabled()
+      || proc->extension_enabled(EXT_ZICCID))
+    return std::make_tuple(false, 0, 0);
+
+  reg_t vpn = vaddr >> PGSHIFT, pgoff = vaddr % PGSIZE;
+  reg_t ctx = current_tlb_context();
+  if (!l2_tlb.empty()) {
+    auto set = &l2_tlb[(vpn % l2_tlb_sets) * L2_TLB_WAYS];
+    for (size_t i = 0; i < L2_TLB_WAYS; i++) {
+      auto& entry = set[i];
+      if (entry.vpn == vpn && entry.ctx == ctx && entry.type == type) {
+        install_tlb(vaddr, entry.data, entry.mmio, type);
+        auto host_addr = entry.mmio ? 0 : entry.data.host_addr + pgoff;
+        return std::make_tuple(true, host_addr, entry.data.target_addr + pgoff);
+      }
+    }
+  }
+
+  for (auto& sp : superpage_tlb) {
+    if ((vaddr & ~sp.mask) == sp.vbase && sp.ctx == ctx && sp.type == type) {
+      reg_t paddr = sp.pbase + (vaddr & sp.mask);
+      char* host_addr = sim->addr_to_mem(paddr);
+      tlb_entry_t entry = {uintptr_t(host_addr) - pgoff, paddr - pgoff};
+      install_tlb(vaddr, entry, !host_addr, type);
+      return std::make_tuple(true, uintptr_t(host_addr), paddr);
+    }
+  }
+
+  return std::make_tuple(false, 0, 0);
+}
+
+void mmu_t::insert_superpage_tlb(mem_access_info_t access_info, reg_t paddr, reg_t size)
+{
+  // Only ordinary accesses made in the current translation context can be
+  // looked up again by access_l2_tlb().
+  reg_t pbase = paddr & ~(size - 1);
+  if (access_info.flags.is_special_access() || in_mprv() || access_info.effective_virt
+      || proc->get_log_commits_enabled() || proc->extension_enabled(EXT_ZICCID)
+      || !pmp_homogeneous(pbase, size))
+    return;
+
+  auto& entry = superpage_tlb[superpage_tlb_victim++ % SUPERPAGE_TLB_ENTRIES];
+  entry.vbase = access_info.vaddr & ~(size - 1);
+  entry.mask = size - 1;
+  entry.pbase = pbase;
+  entry.ctx = current_tlb_context();
+  entry.type = access_info.type;
+}
+
 [[noreturn]] void throw_access_exception(bool virt, reg_t addr, access_type type)
 {
   switch (type) {
@@ -68,7 +276,7 @@ void mmu_t::flush_tlb()
   }
 }
 
-reg_t mmu_t::translate(mem_access_info_t access_info, reg_t len)
+reg_t mmu_t::translate(mem_access_info_t access_info, reg_t len, reg_t* leaf_size)
 {
   reg_t addr = access_info.transformed_vaddr;
   access_type type = access_info.type;
@@ -78,7 +286,10 @@ reg_t mmu_t::translate(mem_access_info_t access_info, reg_t len)
   bool virt = access_info.effective_virt;
   reg_t mode = (reg_t) access_info.effective_priv;
 
-  reg_t paddr = walk(access_info) | (addr & (PGSIZE-1));
+  reg_t size = PGSIZE;
+  reg_t paddr = walk(access_info, &size) | (addr & (PGSIZE-1));
+  if (leaf_size)
+    *leaf_size = size;
 
   reg_t satp = proc->get_state()->satp->readvirt(virt);
   if (proc->extension_enabled_const(EXT_SSPMP)) {
@@ -87,6 +298,10 @@ reg_t mmu_t::translate(mem_access_info_t access_info, reg_t len)
   }
   if (!pmp_ok(paddr, len, access_info.flags.ss_access ? STORE : type, mode, access_info.flags.hlvx))
     throw_access_exception(virt, addr, access_info.flags.ss_access ? STORE : type);
+
+  if (size > PGSIZE)
+    insert_superpage_tlb(access_info, paddr, size);
+
   return paddr;
 }
 
@@ -122,8 +337,12 @@ mmu_t::insn_parcel_t mmu_t::fetch_slow_path(reg_t vaddr)
     check_triggers(triggers::OPERATION_EXECUTE, vaddr,
       access_info.effective_virt, sizeof(insn_parcel_t));
 
+  if (!tlb_hit)
+    std::tie(tlb_hit, host_addr, paddr) = access_l2_tlb(vaddr, FETCH);
+
   if (!tlb_hit) {
-    paddr = translate(access_info, sizeof(insn_parcel_t));
+    reg_t leaf_size = PGSIZE;
+    paddr = translate(access_info, sizeof(insn_parcel_t), &leaf_size);
     host_addr = (uintptr_t)sim->addr_to_mem(paddr);
 
     if (proc->extension_enabled(EXT_ZICCID)) {
@@ -134,7 +353,7 @@ mmu_t::insn_parcel_t mmu_t::fetch_slow_path(reg_t vaddr)
       tlb_insn_reverse_tags.insert(paddr >> PGSHIFT);
     }
 
-    refill_tlb(vaddr, paddr, (char*)host_addr, FETCH);
+    refill_tlb(vaddr, paddr, (char*)host_addr, FETCH, leaf_size);
   }
 
   auto res = perform_intrapage_fetch(vaddr, host_addr, paddr);
@@ -191,6 +410,10 @@ bool mmu_t::mmio(reg_t paddr, size_t len, uint8_t* bytes, access_type type)
   bool naturally_aligned = (paddr & (len - 1)) == 0;
 
   if (power_of_2 && naturally_aligned) {
+    reg_t offset;
+    if (auto dev = mmio_tlb_lookup(paddr, len, offset))
+      return type == STORE ? dev->store(offset, len, bytes) : dev->load(offset, len, bytes);
+
     if (!mmio_ok(paddr, len, type))
       return false;
 
@@ -208,6 +431,24 @@ bool mmu_t::mmio(reg_t paddr, size_t len, uint8_t* bytes, access_type type)
   return true;
 }
 
+abstract_device_t* mmu_t::mmio_tlb_lookup(reg_t paddr, size_t len, reg_t& offset)
+{
+  reg_t ppn = paddr >> PGSHIFT;
+  auto& entry = mmio_tlb[ppn % TLB_ENTRIES];
+  if (entry.ppn != ppn || paddr - entry.base >= entry.size ||
+      entry.size - (paddr - entry.base) < len) {
+    auto [base, dev] = sim->find_mmio_device(paddr);
+    if (!dev)
+      return nullptr;
+    entry = {ppn, dev, base, dev->size()};
+    if (paddr - base >= entry.size || entry.size - (paddr - base) < len)
+      return nullptr;
+  }
+
+  offset = paddr - entry.base;
+  return entry.dev;
+}
+
 void mmu_t::check_triggers(triggers::operation_t operation,
   reg_t addr, bool virt, std::size_t data_size, const std::uint8_t* bytes)
 {
@@ -265,12 +506,16 @@ void mmu_t::load_slow_path_intrapage(reg_t len, uint8_t* bytes, mem_access_info_
   reg_t vaddr = access_info.vaddr;
   auto [tlb_hit, host_addr, paddr] = access_tlb(tlb_load, vaddr, TLB_FLAGS);
   bool special = access_info.flags.is_special_access() && !access_info.flags.lr;
+  if (!tlb_hit && !special)
+    std::tie(tlb_hit, host_addr, paddr) = access_l2_tlb(vaddr, LOAD);
+
   if (!tlb_hit || special) {
-    paddr = translate(access_info, len);
+    reg_t leaf_size = PGSIZE;
+    paddr = translate(access_info, len, &leaf_size);
     host_addr = (uintptr_t)sim->addr_to_mem(paddr);
 
     if (!special)
-      refill_tlb(vaddr, paddr, (char*)host_addr, LOAD);
+      refill_tlb(vaddr, paddr, (char*)host_addr, LOAD, leaf_size);
   }
 
   if (access_info.flags.lr && !sim->reservable(paddr)) {
@@ -338,7 +583,9 @@ void mmu_t::load_slow_path(reg_t original_addr, std::size_t len,
 
 inline void mmu_t::perform_intrapage_store(reg_t vaddr, uintptr_t host_addr, reg_t paddr, reg_t len, const uint8_t* bytes, xlate_flags_t xlate_flags)
 {
-  if (host_addr) {
+  if (host_addr && unlikely(parallel_harts)) {
+    shared_host_store(host_addr, bytes, len);
+  } else if (host_addr) {
      memcpy((char*)host_addr, bytes, len);
   } else if (!mmio_store(paddr, len, bytes)) {
     auto access_info = generate_access_info(vaddr, STORE, xlate_flags);
@@ -353,8 +600,12 @@ void mmu_t::store_slow_path_intrapage(reg_t len, const uint8_t* bytes, mem_acces
 {
   reg_t vaddr = access_info.vaddr;
   auto [tlb_hit, host_addr, paddr] = access_tlb(tlb_store, vaddr, TLB_FLAGS);
+  if (!tlb_hit && !access_info.flags.is_special_access())
+    std::tie(tlb_hit, host_addr, paddr) = access_l2_tlb(vaddr, STORE);
+
   if (!tlb_hit || access_info.flags.is_special_access()) {
-    paddr = translate(access_info, len);
+    reg_t leaf_size = PGSIZE;
+    paddr = translate(access_info, len, &leaf_size);
     host_addr = (uintptr_t)sim->addr_to_mem(paddr);
 
     if (proc && proc->extension_enabled(EXT_ZICCID)) {
@@ -366,7 +617,7 @@ void mmu_t::store_slow_path_intrapage(reg_t len, const uint8_t* bytes, mem_acces
     }
 
     if (!access_info.flags.is_special_access())
-      refill_tlb(vaddr, paddr, (char*)host_addr, STORE);
+      refill_tlb(vaddr, paddr, (char*)host_addr, STORE, leaf_size);
   }
 
   if (actually_store)
@@ -460,10 +711,8 @@ void mmu_t::flush_itlb_ppn(reg_t ppn)
     flush_icache();
 }
 
-tlb_entry_t mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_type type)
+tlb_entry_t mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_type type, reg_t leaf_size)
 {
-  reg_t idx = (vaddr >> PGSHIFT) % TLB_ENTRIES;
-  reg_t expected_tag = vaddr >> PGSHIFT;
   reg_t base_paddr = paddr & ~reg_t(PGSIZE - 1);
 
   tlb_entry_t entry = {uintptr_t(host_addr) - (vaddr % PGSIZE), paddr - (vaddr % PGSIZE)};
@@ -473,8 +722,43 @@ tlb_entry_t mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_
       || (proc && proc->get_log_commits_enabled()))
     return entry;
 
+  // The L2 TLB is tagged by base page, so an sfence.vma of one address
+  // could not find the other pages of a superpage there.  Those are left to
+  // the superpage TLB, which a fence of any address within them does flush.
+  if (proc && !proc->extension_enabled(EXT_ZICCID) && leaf_size == PGSIZE)
+    insert_l2_tlb(vaddr, entry, !host_addr, type);
+
+  install_tlb(vaddr, entry, !host_addr, type);
+  return entry;
+}
+
+void mmu_t::insert_l2_tlb(reg_t vaddr, tlb_entry_t entry, bool mmio, access_type type)
+{
+  if (l2_tlb.empty())
+    return;
+
+  reg_t vpn = vaddr >> PGSHIFT;
+  reg_t ctx = current_tlb_context();
+  auto set = &l2_tlb[(vpn % l2_tlb_sets) * L2_TLB_WAYS];
+  auto victim = &set[l2_tlb_victim++ % L2_TLB_WAYS];
+  for (size_t i = 0; i < L2_TLB_WAYS; i++) {
+    if (!l2_tlb_entry_live(set[i]) ||
+        (set[i].vpn == vpn && set[i].ctx == ctx && set[i].type == type)) {
+      victim = &set[i];
+      break;
+    }
+  }
+  *victim = {vpn, ctx, entry, uint8_t(type), mmio};
+}
+
+void mmu_t::install_tlb(reg_t vaddr, tlb_entry_t entry, bool mmio, access_type type)
+{
+  reg_t idx = (vaddr >> PGSHIFT) % TLB_ENTRIES;
+  reg_t expected_tag = vaddr >> PGSHIFT;
+  reg_t base_paddr = entry.target_addr;
+
   auto trace_flag = tracer.interested_in_range(base_paddr, base_paddr + PGSIZE, type) ? TLB_CHECK_TRACER : 0;
-  auto mmio_flag = host_addr ? 0 : TLB_MMIO;
+  auto mmio_flag = mmio ? TLB_MMIO : 0;
 
   switch (type) {
     case FETCH:
@@ -492,8 +776,6 @@ tlb_entry_t mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_
     default:
       abort();
   }
-
-  return entry;
 }
 
 class always_fail_pmp_t : public base_pmpaddr_csr_t {
@@ -583,7 +865,8 @@ reg_t mmu_t::s2xlate(reg_t gva, reg_t gpa, access_type type, access_type trap_ty
   if (!virt)
     return gpa;
 
-  vm_info vm = decode_vm_info(proc->get_const_xlen(), true, 0, proc->get_state()->hgatp->read());
+  reg_t hgatp = proc->get_state()->hgatp->read();
+  vm_info vm = decode_vm_info(proc->get_const_xlen(), true, 0, hgatp);
   if (vm.levels == 0)
     return gpa;
 
@@ -602,7 +885,7 @@ reg_t mmu_t::s2xlate(reg_t gva, reg_t gpa, access_type type, access_type trap_ty
 
   reg_t base = vm.ptbase;
   if ((gpa & ~maxgpa) == 0) {
-    for (int i = vm.levels - 1; i >= 0; i--) {
+    for (int i = walk_cache_lookup(true, hgatp, 0, gpa, vm.levels, vm.idxbits, base); i >= 0; i--) {
       int ptshift = i * vm.idxbits;
       int idxbits = (i == (vm.levels - 1)) ? vm.idxbits + vm.widenbits : vm.idxbits;
       reg_t idx = (gpa >> (PGSHIFT + ptshift)) & ((reg_t(1) << idxbits) - 1);
@@ -629,6 +912,7 @@ reg_t mmu_t::s2xlate(reg_t gva, reg_t gpa, access_type type, access_type trap_ty
         if (pte & (PTE_D | PTE_A | PTE_U | PTE_N | PTE_PBMT))
           break;
         base = ppn << PGSHIFT;
+        walk_cache_insert(true, hgatp, 0, gpa, i, vm.idxbits, base);
       } else if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W))) {
         break;
       } else if (((pte & PTE_N) && (ppn == 0 || i != 0)) || (napot_bits != 0 && napot_bits != 4)) {
@@ -646,8 +930,10 @@ reg_t mmu_t::s2xlate(reg_t gva, reg_t gpa, access_type type, access_type trap_ty
 
         if ((pte & ad) != ad) {
           if (hade) {
-            // set accessed and possibly dirty bits
-            pte_store(pte_paddr, pte | ad, gva, virt, trap_type, vm.ptesize);
+            // set accessed and possibly dirty bits, starting over if
+            // another hart changed the PTE since it was read
+            if (!pte_store(pte_paddr, pte, pte | ad, gva, virt, trap_type, vm.ptesize))
+              return s2xlate(gva, gpa, type, trap_type, virt, hlvx, is_for_vs_pt_addr);
           } else {
             // take exception if access or possibly dirty bit is not set.
             break;
@@ -702,7 +988,7 @@ bool mmu_t::svukte_fault(reg_t addr, mem_access_info_t access_info)
   return addr >> (proc->get_xlen() - 1);
 }
 
-reg_t mmu_t::walk(mem_access_info_t access_info)
+reg_t mmu_t::walk(mem_access_info_t access_info, reg_t* leaf_size)
 {
   access_type type = access_info.type;
   reg_t addr = access_info.transformed_vaddr;
@@ -739,8 +1025,9 @@ reg_t mmu_t::walk(mem_access_info_t access_info)
   if (masked_msbs != 0 && masked_msbs != mask)
     vm.levels = 0;
 
+  reg_t hgatp = virt ? proc->get_state()->hgatp->read() : 0;
   reg_t base = vm.ptbase;
-  for (int i = vm.levels - 1; i >= 0; i--) {
+  for (int i = walk_cache_lookup(false, satp, hgatp, addr, vm.levels, vm.idxbits, base); i >= 0; i--) {
     int ptshift = i * vm.idxbits;
     reg_t idx = (addr >> (PGSHIFT + ptshift)) & ((1 << vm.idxbits) - 1);
 
@@ -768,6 +1055,7 @@ reg_t mmu_t::walk(mem_access_info_t access_info)
       if (pte & (PTE_D | PTE_A | PTE_U | PTE_N | PTE_PBMT))
         break;
       base = ppn << PGSHIFT;
+      walk_cache_insert(false, satp, hgatp, addr, i, vm.idxbits, base);
     } else if ((pte & PTE_U) ? s_mode && (type == FETCH || !sum) : !s_mode) {
       break;
     } else if (!(pte & PTE_V) ||
@@ -801,8 +1089,10 @@ reg_t mmu_t::walk(mem_access_info_t access_info)
           // Check for write permission to the first-stage PT in second-stage
           // PTE and set the D bit in the second-stage PTE if needed
           s2xlate(addr, base + idx * vm.ptesize, STORE, type, virt, false, true);
-          // set accessed and possibly dirty bits.
-          pte_store(pte_paddr, pte | ad, addr, virt, type, vm.ptesize);
+          // set accessed and possibly dirty bits, starting over if
+          // another hart changed the PTE since it was read
+          if (!pte_store(pte_paddr, pte, pte | ad, addr, virt, type, vm.ptesize))
+            return walk(access_info, leaf_size);
         } else {
           // take exception if access or possibly dirty bit is not set.
           break;
@@ -816,6 +1106,8 @@ reg_t mmu_t::walk(mem_access_info_t access_info)
                         | (vpn & ((reg_t(1) << napot_bits) - 1))
                         | (vpn & ((reg_t(1) << ptshift) - 1))) << PGSHIFT;
       reg_t phys = page_base | (addr & page_mask);
+      if (leaf_size)
+        *leaf_size = reg_t(PGSIZE) << (ptshift + napot_bits);
       return s2xlate(addr, phys, type, type, virt, hlvx, false) & ~page_mask;
     }
   }
@@ -15,9 +15,13 @@
 #include "cfg.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <optional>
 #include <stdlib.h>
+#include <vector>
 
 // virtual memory configuration
 #define PGSHIFT 12
@@ -46,10 +50,21 @@ struct insn_fetch_t
 
 struct icache_entry_t {
   reg_t tag;
-  icache_entry_t* next;
   insn_fetch_t data;
 };
 
+// a straight-line run of length instructions starting at tag, all within
+// one page.  Only the last may branch, serialize or flush the I$ (see
+// mmu_t::ends_bb()), so the block runs to its end with no check on the
+// instructions before it.
+static const size_t BB_CACHE_MAX_INSNS = 16;
+
+struct bb_cache_entry_t {
+  reg_t tag;
+  size_t length;
+  insn_fetch_t insns[BB_CACHE_MAX_INSNS];
+};
+
 struct tlb_entry_t {
   uintptr_t host_addr;
   reg_t target_addr;
@@ -60,9 +75,88 @@ struct dtlb_entry_t {
   reg_t tag;
 };
 
-struct pte_cache_entry_t {
-  reg_t paddr;
-  reg_t pte;
+// With --parallel-harts, each 64-byte granule of host memory has a store
+// sequence number (hashed, so granules may share one).  It is odd while a
+// store to the granule is in progress and goes up by two with each store.
+// LR reads its value together with the sequence number and SC only
+// succeeds if the number is unchanged, so any store by another hart in
+// between, even one that puts back the value LR saw, makes SC fail.
+struct alignas(64) store_seq_t {
+  std::atomic<uint64_t> seq;
+
+  uint64_t read_begin() const
+  {
+    uint64_t s;
+    while ((s = seq.load(std::memory_order_acquire)) & 1)
+      ;
+    return s;
+  }
+
+  bool read_end(uint64_t s) const
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq.load(std::memory_order_relaxed) == s;
+  }
+
+  bool try_lock(uint64_t s)
+  {
+    return seq.compare_exchange_strong(s, s + 1, std::memory_order_acquire);
+  }
+
+  void lock()
+  {
+    uint64_t s = seq.load(std::memory_order_relaxed);
+    while ((s & 1) || !seq.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+      s = seq.load(std::memory_order_relaxed);
+  }
+
+  void unlock()
+  {
+    seq.fetch_add(1, std::memory_order_release);
+  }
+};
+
+// The first-level TLBs only hold translations for the current context and
+// are flushed whenever it changes.  Behind them is a larger, set-associative
+// TLB whose entries are tagged with the context they were made in, so that
+// they survive context switches and only sfence.vma and friends remove them.
+struct l2_tlb_entry_t {
+  reg_t vpn;
+  reg_t ctx; // id of the tlb_context_t, or 0 if invalid
+  tlb_entry_t data;
+  uint8_t type; // access_type
+  bool mmio;
+};
+
+// A superpage or Svnapot translation made by walk(), from which misses in
+// the TLBs above are refilled page by page without walking again.  Entries
+// are only made when PMP treats the whole superpage alike, so the refills
+// need no PMP checks either.
+struct superpage_tlb_entry_t {
+  reg_t vbase;
+  reg_t mask; // superpage size - 1
+  reg_t pbase;
+  reg_t ctx;
+  uint8_t type;
+};
+
+// The device last accessed in an MMIO page, so that further accesses to it
+// skip simif_t and the bus.  Devices do not move, so entries are keyed by
+// physical page and never need flushing.
+struct mmio_tlb_entry_t {
+  reg_t ppn; // -1 if invalid
+  abstract_device_t* dev;
+  reg_t base;
+  reg_t size;
+};
+
+// A non-leaf PTE met by a page-table walk: the next-level table it points to
+// for addresses whose bits above its level equal prefix.
+struct walk_cache_entry_t {
+  reg_t atp; // satp, vsatp or hgatp the walk started from, or -1 if invalid
+  reg_t hgatp; // for VS-stage walks, the hgatp that maps their tables
+  reg_t prefix;
+  reg_t base;
 };
 
 struct xlate_flags_t {
@@ -118,9 +212,73 @@ public:
     return from_target(res);
   }
 
+  // For unit-stride vector accesses: copy elements between memory at addr
+  // and a host buffer for as long as load() or store() would take its fast
+  // path, translating once per page rather than once per element.  Returns
+  // how many of the n elements were copied.
+  template<typename T>
+  size_t load_bulk(reg_t addr, size_t n, T* dst) {
+    if (target_big_endian != is_be() || (addr & (sizeof(T) - 1)) != 0)
+      return 0;
+
+    size_t done = 0;
+    while (done < n) {
+      reg_t vaddr = addr + done * sizeof(T);
+      auto [tlb_hit, host_addr, _] = access_tlb(tlb_load, vaddr);
+      if (!tlb_hit)
+        break;
+
+      size_t count = std::min(n - done, (PGSIZE - vaddr % PGSIZE) / sizeof(T));
+      memcpy(dst + done, (const void*)host_addr, count * sizeof(T));
+      for (size_t i = done; i < done + count; i++)
+        MMU_OBSERVE_LOAD(addr + i * sizeof(T), dst[i], sizeof(T));
+      done += count;
+    }
+
+    return done;
+  }
+
+  template<typename T>
+  size_t store_bulk(reg_t addr, size_t n, const T* src) {
+    if (target_big_endian != is_be() || (addr & (sizeof(T) - 1)) != 0)
+      return 0;
+
+    size_t done = 0;
+    while (done < n) {
+      reg_t vaddr = addr + done * sizeof(T);
+      auto [tlb_hit, host_addr, _] = access_tlb(tlb_store, vaddr);
+      if (!tlb_hit)
+        break;
+
+      size_t count = std::min(n - done, (PGSIZE - vaddr % PGSIZE) / sizeof(T));
+      for (size_t i = done; i < done + count; i++)
+        MMU_OBSERVE_STORE(addr + i * sizeof(T), src[i], sizeof(T));
+      if (unlikely(parallel_harts))
+        shared_host_store(host_addr, src + done, count * sizeof(T));
+      else
+        memcpy((void*)host_addr, src + done, count * sizeof(T));
+      done += count;
+    }
+
+    return done;
+  }
+
   template<typename T>
   T load_reserved(reg_t addr) {
-    return load<T>(addr, {.lr = true});
+    size_t log_size = proc ? proc->get_state()->log_mem_read.size() : 0;
+    T res = load<T>(addr, {.lr = true});
+    if (unlikely(parallel_harts)) {
+      // load again, this time consistently with the store sequence number,
+      // logging only the last of the loads
+      auto& seq = store_seq((uintptr_t)sim->addr_to_mem(load_reservation_address));
+      do {
+        if (proc)
+          proc->get_state()->log_mem_read.resize(log_size);
+        load_reservation_seq = seq.read_begin();
+        res = load<T>(addr, {.lr = true});
+      } while (!seq.read_end(load_reservation_seq));
+    }
+    return res;
   }
 
   template<typename T>
@@ -148,7 +306,12 @@ public:
     auto [tlb_hit, host_addr, _] = access_tlb(tlb_store, addr);
 
     if (!xlate_flags.is_special_access() && likely(aligned && tlb_hit)) {
-      *(target_endian<T>*)host_addr = to_target(val);
+      if (unlikely(parallel_harts)) {
+        target_endian<T> target_val = to_target(val);
+        shared_host_store(host_addr, &target_val, sizeof(T));
+      } else {
+        *(target_endian<T>*)host_addr = to_target(val);
+      }
     } else {
       target_endian<T> target_val = to_target(val);
       store_slow_path(addr, sizeof(T), (const uint8_t*)&target_val, xlate_flags, true, false);
@@ -196,6 +359,8 @@ public:
     convert_load_traps_to_store_traps({
       store_slow_path(addr, sizeof(T), nullptr, {}, false, enforce_amo_alignment(addr, sizeof(T)));
       auto lhs = load<T>(addr);
+      if (auto host_addr = atomic_host_addr(addr, sizeof(T)))
+        return host_amo<T>(host_addr, f);
       store<T>(addr, f(lhs));
       return lhs;
     })
@@ -217,6 +382,10 @@ public:
     convert_load_traps_to_store_traps({
       store_slow_path(addr, sizeof(T), nullptr, {}, false, enforce_amo_alignment(addr, sizeof(T)));
       auto lhs = load<T>(addr);
+      if constexpr (sizeof(T) <= sizeof(uint64_t)) {
+        if (auto host_addr = atomic_host_addr(addr, sizeof(T)))
+          return host_amo<T>(host_addr, [&](T v) { return v == comp ? swap : v; });
+      }
       if (lhs == comp)
         store<T>(addr, swap);
       return lhs;
@@ -279,14 +448,95 @@ public:
   {
     bool have_reservation = check_load_reservation(addr, sizeof(T));
 
-    if (have_reservation)
+    if (have_reservation && unlikely(parallel_harts)) {
+      auto& seq = store_seq((uintptr_t)sim->addr_to_mem(load_reservation_address));
+      have_reservation = seq.try_lock(load_reservation_seq);
+      if (have_reservation) {
+        // the store must not wait for the sequence number SC now holds
+        struct release_t {
+          mmu_t* mmu;
+          ~release_t() { mmu->held_store_seq->unlock(); mmu->held_store_seq = nullptr; }
+        } release{this};
+        held_store_seq = &seq;
+        store(addr, val);
+      }
+    } else if (have_reservation) {
       store(addr, val);
+    }
 
     yield_load_reservation();
 
     return have_reservation;
   }
 
+  // When harts run on separate host threads, AMOs to ordinary memory are
+  // carried out directly on host memory.  This returns the host
+  // address of a naturally aligned access of up to 8 bytes that hits in
+  // the store TLB with no flags set, or 0 if the access must go through
+  // the regular (non-atomic) path.
+  uintptr_t atomic_host_addr(reg_t addr, size_t len)
+  {
+    if (likely(!parallel_harts) || len > sizeof(uint64_t) || (addr & (len - 1)))
+      return 0;
+
+    auto [tlb_hit, host_addr, _] = access_tlb(tlb_store, addr);
+    if (!tlb_hit) {
+      // translate and refill without storing; faults were already taken
+      store_slow_path(addr, len, nullptr, {}, false, true);
+      std::tie(tlb_hit, host_addr, _) = access_tlb(tlb_store, addr);
+    }
+    return tlb_hit ? host_addr : 0;
+  }
+
+  // Every store to RAM takes its granule's store sequence number, so an
+  // AMO need only hold it across the read-modify-write.
+  template<typename T, typename op>
+  T host_amo(uintptr_t host_addr, op f)
+  {
+    auto& seq = store_seq(host_addr);
+    seq.lock();
+    auto ptr = (target_endian<T>*)host_addr;
+    T old_val = from_target(*ptr);
+    *ptr = to_target(T(f(old_val)));
+    seq.unlock();
+    return old_val;
+  }
+
+  static const size_t STORE_SEQ_GRANULE = 64;
+  static const size_t STORE_SEQ_ENTRIES = 4096;
+  static store_seq_t store_seqs[STORE_SEQ_ENTRIES];
+
+  static store_seq_t& store_seq(uintptr_t host_addr)
+  {
+    return store_seqs[host_addr / STORE_SEQ_GRANULE % STORE_SEQ_ENTRIES];
+  }
+
+  // Store to RAM as harts on separate host threads must, one granule at a
+  // time under its store sequence number.  Misaligned stores need not be
+  // single-copy atomic, so those that span granules are split.
+  void shared_host_store(uintptr_t host_addr, const void* bytes, size_t len)
+  {
+    while (len > 0) {
+      size_t n = std::min(len, STORE_SEQ_GRANULE - host_addr % STORE_SEQ_GRANULE);
+      auto& seq = store_seq(host_addr);
+      bool held = &seq == held_store_seq;
+      if (!held)
+        seq.lock();
+      memcpy((void*)host_addr, bytes, n);
+      if (!held)
+        seq.unlock();
+      host_addr += n;
+      bytes = (const char*)bytes + n;
+      len -= n;
+    }
+  }
+
+  void fence()
+  {
+    if (parallel_harts)
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
   static const reg_t ICACHE_ENTRIES = 4096;
 
   inline size_t icache_index(reg_t addr)
@@ -314,9 +564,11 @@ public:
       length = insn_length(insn);
     }
 
-    insn_fetch_t fetch = {proc->decode_insn(insn), insn};
+    // Decode through the cache shared with the other harts, unless the
+    // fetch could not leave a translation in the ITLB to find paddr with.
+    auto [in_itlb, itlb_host_addr, fetch_paddr] = access_tlb(tlb_insn, addr, TLB_FLAGS);
+    insn_fetch_t fetch = {in_itlb ? proc->decode_insn(insn, fetch_paddr) : proc->decode_insn(insn), insn};
     entry->tag = addr;
-    entry->next = &icache[icache_index(addr + length)];
     entry->data = fetch;
 
     auto [check_tracer, _, paddr] = access_tlb(tlb_insn, addr, TLB_FLAGS, TLB_CHECK_TRACER);
@@ -326,23 +578,120 @@ public:
         tracer.trace(paddr, paddr + length, FETCH);
       }
     }
-    MMU_OBSERVE_FETCH(addr, insn, length);
     return entry;
   }
 
-  inline icache_entry_t* access_icache(reg_t addr)
+  // the I$ entry for addr, refilled if it misses, without MMU_OBSERVE_FETCH
+  inline icache_entry_t* lookup_icache(reg_t addr)
   {
     icache_entry_t* entry = &icache[icache_index(addr)];
-    if (likely(entry->tag == addr)){
-      MMU_OBSERVE_FETCH(addr, entry->data.insn, insn_length(entry->data.insn.bits()));
+    if (likely(entry->tag == addr))
       return entry;
-    }
     return refill_icache(addr, entry);
   }
 
+  inline icache_entry_t* access_icache(reg_t addr)
+  {
+    icache_entry_t* entry = lookup_icache(addr);
+    observe_fetch(addr, entry->data.insn);
+    return entry;
+  }
+
+  inline void observe_fetch(reg_t UNUSED addr, insn_t UNUSED insn)
+  {
+    MMU_OBSERVE_FETCH(addr, insn, insn_length(insn.bits()));
+  }
+
+  static const reg_t BB_CACHE_ENTRIES = 512;
+
+  inline size_t bb_cache_index(reg_t addr)
+  {
+    return (addr / PC_ALIGN) % BB_CACHE_ENTRIES;
+  }
+
+  // Whether a block must end after insn: anything that may set the pc
+  // other than by trapping (branches, jumps, xRET, CSR accesses, which
+  // serialize, and Zcmp/Zcmt's cm.popret and cm.jalt), fence.i, and
+  // instructions with custom or longer encodings, whose effects are unknown.
+  inline bool ends_bb(insn_t insn)
+  {
+    if (insn_length(insn.bits()) > 4)
+      return true;
+
+    if (insn_length(insn.bits()) == 2) {
+      auto funct3 = (insn.bits() >> 13) & 7;
+      switch (insn.rvc_opcode()) {
+        case 1: // C.JAL (RV32 only), C.J, C.BEQZ, C.BNEZ
+          return funct3 >= 5 || (funct3 == 1 && proc->get_xlen() == 32);
+        case 2: // C.JR, C.JALR, C.EBREAK (but not C.MV, C.ADD); C.FSDSP,
+                // cm.popret, cm.jalt
+          return (funct3 == 4 && insn.rvc_rs2() == 0) || funct3 == 5;
+        default:
+          return false;
+      }
+    }
+
+    switch (insn.opcode()) {
+      case 0x0b: case 0x2b: case 0x5b: case 0x7b: // custom-0 to custom-3
+      case 0x0f: // MISC-MEM
+      case 0x63: // BRANCH
+      case 0x67: // JALR
+      case 0x6f: // JAL
+      case 0x73: // SYSTEM
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // Build a block by following sequential I$ entries up to one that ends
+  // it.  Only the first instruction may take the slow fetch path; the block
+  // is extended only while the following parcels hit in the ITLB with no
+  // flags set, so pre-decoding them can neither trap nor be observed by a
+  // tracer.  Fetches are observed as the block's instructions run.
+  inline bb_cache_entry_t* refill_bb_cache(reg_t addr, bb_cache_entry_t* entry)
+  {
+    entry->tag = -1;
+
+    auto ic_entry = lookup_icache(addr);
+    entry->insns[0] = ic_entry->data;
+    entry->length = 1;
+
+    if (unlikely(ic_entry->tag != addr))
+      return entry;
+
+    reg_t pc = addr;
+    while (entry->length < BB_CACHE_MAX_INSNS && !ends_bb(ic_entry->data.insn)) {
+      pc += insn_length(ic_entry->data.insn.bits());
+      if (pc / PGSIZE != addr / PGSIZE
+          || pc % PGSIZE > PGSIZE - MAX_INSN_LENGTH
+          || !std::get<0>(access_tlb(tlb_insn, pc)))
+        break;
+
+      ic_entry = lookup_icache(pc);
+      if (ic_entry->tag != pc)
+        break;
+
+      entry->insns[entry->length++] = ic_entry->data;
+    }
+
+    entry->tag = addr;
+    return entry;
+  }
+
+  inline bb_cache_entry_t* access_bb_cache(reg_t addr)
+  {
+    bb_cache_entry_t* entry = &bb_cache[bb_cache_index(addr)];
+    if (likely(entry->tag == addr))
+      return entry;
+    return refill_bb_cache(addr, entry);
+  }
+
   inline insn_fetch_t load_insn(reg_t addr)
   {
-    return refill_icache(addr, &icache[icache_index(addr)])->data;
+    auto entry = refill_icache(addr, &icache[icache_index(addr)]);
+    observe_fetch(addr, entry->data.insn);
+    return entry->data;
   }
 
   std::tuple<bool, uintptr_t, reg_t> ALWAYS_INLINE access_tlb(const dtlb_entry_t* tlb, reg_t vaddr, reg_t allowed_flags = 0, reg_t required_flags = 0)
@@ -357,6 +706,15 @@ public:
   }
 
   void flush_tlb();
+  // The translation context (privilege, V, satp, vsatp, hgatp, SUM, MXR...)
+  // changed: flush the first-level TLBs, keeping the context-tagged L2 TLB.
+  void flush_tlb_context();
+  // sfence.vma and hfence.vvma: flush translations for vaddr, or all pages
+  // if unset, in address space asid, or all address spaces if unset.  With
+  // virt, only guest translations under the current VMID are affected.
+  void flush_tlb_vma(bool virt, std::optional<reg_t> vaddr, std::optional<reg_t> asid);
+  // hfence.gvma: flush all guest translations under vmid, or all VMIDs.
+  void flush_tlb_gvma(std::optional<reg_t> vmid);
   void flush_icache();
 
   void register_memtracer(memtracer_t*);
@@ -386,11 +744,22 @@ private:
   processor_t* proc;
   memtracer_list_t tracer;
   reg_t load_reservation_address;
+  uint64_t load_reservation_seq;
+  store_seq_t* held_store_seq;
+  const bool parallel_harts;
   reg_t blocksz;
 
   // implement an instruction cache for simulator performance
   icache_entry_t icache[ICACHE_ENTRIES];
 
+  // cache of straight-line blocks built from the I$, flushed along with it.
+  // Blocks are keyed by vaddr alone: every change of privilege, satp, vsatp,
+  // hgatp or XLEN already flushes the I$ through flush_tlb_context().
+  bb_cache_entry_t bb_cache[BB_CACHE_ENTRIES];
+  // how many instructions of the executing block to run; flush_icache()
+  // clears it so that the block ends after the current instruction
+  size_t bb_end;
+
   // implement a TLB for simulator performance
   static const reg_t TLB_ENTRIES = 256;
   // If a TLB tag has TLB_CHECK_TRIGGERS set, then the MMU must check for a
@@ -403,8 +772,60 @@ private:
   dtlb_entry_t tlb_store[TLB_ENTRIES];
   dtlb_entry_t tlb_insn[TLB_ENTRIES];
 
-  static const reg_t PTE_CACHE_ENTRIES = 251;
-  pte_cache_entry_t pte_cache[PTE_CACHE_ENTRIES];
+  // Everything a translation depends on that can change without a full
+  // flush_tlb().  Context IDs are never reused, so retiring a context (when
+  // its slot is recycled, or by an sfence.vma that covers all its pages)
+  // invalidates its L2 TLB entries without visiting them.
+  struct tlb_context_t {
+    std::array<reg_t, 11> key;
+    bool virt;
+    reg_t asid;
+    reg_t vmid;
+    reg_t id; // 0 if the slot is free
+  };
+  static const size_t TLB_CONTEXTS = 64;
+  tlb_context_t tlb_contexts[TLB_CONTEXTS];
+  size_t tlb_context_victim;
+  reg_t tlb_context_generation;
+  reg_t tlb_context; // id of the current context, 0 until it is looked up
+  reg_t current_tlb_context();
+
+  static const size_t L2_TLB_WAYS = 4;
+  size_t l2_tlb_sets;
+  size_t l2_tlb_victim;
+  std::vector<l2_tlb_entry_t> l2_tlb;
+  bool l2_tlb_entry_live(const l2_tlb_entry_t& entry) const
+  {
+    return entry.ctx && tlb_contexts[entry.ctx % TLB_CONTEXTS].id == entry.ctx;
+  }
+
+  mmio_tlb_entry_t mmio_tlb[TLB_ENTRIES];
+  // the device that holds [paddr, paddr + len), setting offset to paddr's
+  // offset within it, or nullptr if it must be accessed through simif_t
+  abstract_device_t* mmio_tlb_lookup(reg_t paddr, size_t len, reg_t& offset);
+
+  static const size_t SUPERPAGE_TLB_ENTRIES = 32;
+  superpage_tlb_entry_t superpage_tlb[SUPERPAGE_TLB_ENTRIES];
+  size_t superpage_tlb_victim;
+  void insert_superpage_tlb(mem_access_info_t access_info, reg_t paddr, reg_t size);
+
+  // on a first-level TLB miss, refill it from the L2 or superpage TLB if
+  // possible
+  std::tuple<bool, uintptr_t, reg_t> access_l2_tlb(reg_t vaddr, access_type type);
+  void insert_l2_tlb(reg_t vaddr, tlb_entry_t entry, bool mmio, access_type type);
+  void install_tlb(reg_t vaddr, tlb_entry_t entry, bool mmio, access_type type);
+
+  // Paging-structure caches for the VS/S-stage and G-stage walks, by level,
+  // so that a walk can start below the deepest level it has seen before.
+  // They are keyed by the root of the walk rather than by context, so they
+  // survive context switches and are only flushed by fences.
+  static const size_t WALK_CACHE_LEVELS = 5;
+  static const size_t WALK_CACHE_ENTRIES = 64;
+  walk_cache_entry_t walk_cache[2][WALK_CACHE_LEVELS][WALK_CACHE_ENTRIES];
+  void flush_walk_cache();
+  // returns the level to start the walk at, setting base to its table
+  int walk_cache_lookup(bool g_stage, reg_t atp, reg_t hgatp, reg_t addr, int levels, int idxbits, reg_t& base);
+  void walk_cache_insert(bool g_stage, reg_t atp, reg_t hgatp, reg_t addr, int level, int idxbits, reg_t base);
 
   typedef bloom_filter_t<reg_t, simple_hash1, simple_hash2, TLB_ENTRIES * 16, 3> reverse_tags_t;
   reverse_tags_t tlb_store_reverse_tags;
@@ -415,14 +836,17 @@ private:
   void flush_stlb_ppn(reg_t ppn);
 
   // finish translation on a TLB miss and update the TLB
-  tlb_entry_t refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_type type);
+  tlb_entry_t refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_type type, reg_t leaf_size = PGSIZE);
   const char* fill_from_mmio(reg_t vaddr, reg_t paddr);
 
   // perform a stage2 translation for a given guest address
   reg_t s2xlate(reg_t gva, reg_t gpa, access_type type, access_type trap_type, bool virt, bool hlvx, bool is_for_vs_pt_addr);
 
   // perform a page table walk for a given VA; set referenced/dirty bits
-  reg_t walk(mem_access_info_t access_info);
+  // leaf_size, if given, is set to the size of the superpage or Svnapot page
+  // that addr falls in (by the VS-stage leaf, for a guest translation), or
+  // left alone for a base page.
+  reg_t walk(mem_access_info_t access_info, reg_t* leaf_size = nullptr);
 
   // handle uncommon cases: TLB misses, page faults, MMIO
   typedef uint16_t insn_parcel_t;
@@ -455,7 +879,7 @@ private:
 
   bool svukte_qualified(mem_access_info_t access_info);
   bool svukte_fault(reg_t addr, mem_access_info_t access_info);
-  reg_t translate(mem_access_info_t access_info, reg_t len);
+  reg_t translate(mem_access_info_t access_info, reg_t len, reg_t* leaf_size = nullptr);
 
   reg_t pte_load(reg_t pte_paddr, reg_t addr, bool virt, access_type trap_type, size_t ptesize) {
     if (ptesize == 4)
@@ -464,18 +888,18 @@ private:
       return pte_load<uint64_t>(pte_paddr, addr, virt, trap_type);
   }
 
-  void pte_store(reg_t pte_paddr, reg_t new_pte, reg_t addr, bool virt, access_type trap_type, size_t ptesize) {
+  // Replace the PTE at pte_paddr, which was read as old_pte, with new_pte.
+  // Returns false, storing nothing, if a hart on another host thread has
+  // changed the PTE in the meantime, so that the walk must start over.
+  bool pte_store(reg_t pte_paddr, reg_t old_pte, reg_t new_pte, reg_t addr, bool virt, access_type trap_type, size_t ptesize) {
     if (ptesize == 4)
-      return pte_store<uint32_t>(pte_paddr, new_pte, addr, virt, trap_type);
+      return pte_store<uint32_t>(pte_paddr, old_pte, new_pte, addr, virt, trap_type);
     else
-      return pte_store<uint64_t>(pte_paddr, new_pte, addr, virt, trap_type);
+      return pte_store<uint64_t>(pte_paddr, old_pte, new_pte, addr, virt, trap_type);
   }
 
   template<typename T> inline reg_t pte_load(reg_t pte_paddr, reg_t addr, bool virt, access_type trap_type)
   {
-    if (auto [hit, pte] = pte_cache_access(pte_paddr); hit)
-      return pte;
-
     const size_t ptesize = sizeof(T);
 
     if (!pmp_ok(pte_paddr, ptesize, LOAD, PRV_S, false))
@@ -489,12 +913,10 @@ private:
       throw_access_exception(virt, addr, trap_type);
     }
 
-    auto res = from_target(target_pte);
-    pte_cache_insert(pte_paddr, res);
-    return res;
+    return from_target(target_pte);
   }
 
-  template<typename T> inline void pte_store(reg_t pte_paddr, reg_t new_pte, reg_t addr, bool virt, access_type trap_type)
+  template<typename T> inline bool pte_store(reg_t pte_paddr, reg_t old_pte, reg_t new_pte, reg_t addr, bool virt, access_type trap_type)
   {
     const size_t ptesize = sizeof(T);
 
@@ -503,25 +925,26 @@ private:
 
     void* host_pte_addr = sim->addr_to_mem(pte_paddr);
     target_endian<T> target_pte = to_target((T)new_pte);
-    if (host_pte_addr) {
+    if (host_pte_addr && unlikely(parallel_harts)) {
+      // compare and swap under the store sequence number, like an AMO
+      auto& seq = store_seq((uintptr_t)host_pte_addr);
+      bool held = &seq == held_store_seq;
+      if (!held)
+        seq.lock();
+      target_endian<T> cur_pte;
+      memcpy(&cur_pte, host_pte_addr, ptesize);
+      bool unchanged = from_target(cur_pte) == (T)old_pte;
+      if (unchanged)
+        memcpy(host_pte_addr, &target_pte, ptesize);
+      if (!held)
+        seq.unlock();
+      return unchanged;
+    } else if (host_pte_addr) {
       memcpy(host_pte_addr, &target_pte, ptesize);
     } else if (!mmio_store(pte_paddr, ptesize, (uint8_t*)&target_pte)) {
       throw_access_exception(virt, addr, trap_type);
     }
-
-    pte_cache_insert(pte_paddr, new_pte);
-  }
-
-  std::tuple<bool, reg_t> pte_cache_access(reg_t key)
-  {
-    auto e = pte_cache[key % PTE_CACHE_ENTRIES];
-    return std::make_tuple(e.paddr == key, e.pte);
-  }
-
-  void pte_cache_insert(reg_t key, reg_t value)
-  {
-    if (value & PTE_V)
-      pte_cache[key % PTE_CACHE_ENTRIES] = {key, value};
+    return true;
   }
 
   inline insn_parcel_t fetch_insn_parcel(reg_t addr) {
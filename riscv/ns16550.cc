@@ -6,6 +6,7 @@
 #include "term.h"
 #include "sim.h"
 #include "dts.h"
+#include "checkpoint.h"
 
 #define UART_QUEUE_SIZE         64
 
@@ -348,6 +349,34 @@ std::string ns16550_generate_dts(const sim_t* sim, const std::vector<std::string
   return s.str();
 }
 
+void ns16550_t::save(std::ostream& o)
+{
+  for (auto reg : {dll, dlm, iir, ier, fcr, lcr, mcr, lsr, msr, scr})
+    checkpoint_put(o, reg);
+
+  auto rx = rx_queue;
+  checkpoint_put(o, uint64_t(rx.size()));
+  for (; !rx.empty(); rx.pop())
+    checkpoint_put(o, rx.front());
+}
+
+void ns16550_t::restore(std::istream& i)
+{
+  for (auto reg : {&dll, &dlm, &iir, &ier, &fcr, &lcr, &mcr, &lsr, &msr, &scr})
+    checkpoint_get(i, *reg);
+
+  uint64_t n;
+  checkpoint_get(i, n);
+  rx_queue = {};
+  for (uint64_t k = 0; k < n; k++) {
+    uint8_t byte;
+    checkpoint_get(i, byte);
+    rx_queue.push(byte);
+  }
+
+  update_interrupt();
+}
+
 ns16550_t* ns16550_parse_from_fdt(const void* fdt, const sim_t* sim, reg_t* base, const std::vector<std::string>& sargs UNUSED)
 {
   uint32_t ns16550_shift, ns16550_io_width, ns16550_int_id;
@@ -1,13 +1,18 @@
 #include <sys/time.h>
 #include <sstream>
+#include <cstring>
 #include "devices.h"
 #include "processor.h"
 #include "simif.h"
 #include "sim.h"
 #include "dts.h"
+#include "checkpoint.h"
 
 #define PLIC_MAX_CONTEXTS 15872
 
+static_assert(PLIC_MAX_DEVICES / 32 <= 32, "active_words has a bit per word");
+static_assert(PLIC_PRIO_LEVELS <= 32, "active_levels has a bit per level");
+
 /*
  * The PLIC consists of memory-mapped control registers, with a memory map
  * as follows:
@@ -85,33 +90,51 @@ plic_t::plic_t(const simif_t* sim, uint32_t ndev)
       contexts.push_back(plic_context_t(hart, false));
     }
   }
+
+  first_enabled.assign(num_ids, contexts.size());
 }
 
-uint32_t plic_t::context_best_pending(const plic_context_t *c)
+// Add id to or remove it from the active sources of c at its current
+// pending_priority.
+void plic_t::context_file(plic_context_t *c, uint32_t id, bool active)
 {
-  uint8_t best_id_prio = 0;
-  uint32_t best_id = 0;
+  uint32_t prio = c->pending_priority[id];
+  uint32_t id_word = id / 32;
+  uint32_t id_mask = 1 << (id % 32);
+  auto& words = c->active[prio];
 
-  for (uint32_t i = 0; i < num_ids_word; i++) {
-    if (!c->pending[i]) {
-      continue;
-    }
+  if (active)
+    words[id_word] |= id_mask;
+  else
+    words[id_word] &= ~id_mask;
 
-    for (uint32_t j = 0; j < 32; j++) {
-      uint32_t id = i * 32 + j;
-      if ((num_ids <= id) ||
-          !(c->pending[i] & (1 << j)) ||
-          (c->claimed[i] & (1 << j))) {
-        continue;
-      }
+  if (words[id_word])
+    c->active_words[prio] |= 1 << id_word;
+  else
+    c->active_words[prio] &= ~(1 << id_word);
 
-      if (!best_id ||
-          (best_id_prio < c->pending_priority[id])) {
-        best_id = id;
-        best_id_prio = c->pending_priority[id];
-      }
-    }
-  }
+  if (c->active_words[prio])
+    c->active_levels |= 1 << prio;
+  else
+    c->active_levels &= ~(1 << prio);
+}
+
+// File id again after a change to its pending or claimed bits, which must
+// be made between removing it with context_file(c, id, false) and this.
+void plic_t::context_refile(plic_context_t *c, uint32_t id)
+{
+  uint32_t id_word = id / 32;
+  uint32_t id_mask = 1 << (id % 32);
+  context_file(c, id, (c->pending[id_word] & id_mask) && !(c->claimed[id_word] & id_mask));
+}
+
+// The active source of highest priority, and of those the lowest ID.
+uint32_t plic_t::context_best_pending(const plic_context_t *c)
+{
+  if (!c->active_levels)
+    return 0;
+
+  uint32_t best_id_prio = 31 - __builtin_clz(c->active_levels);
 
   /*
   From Spec 1.0.0: 6. Priority Thresholds
@@ -122,7 +145,22 @@ uint32_t plic_t::context_best_pending(const plic_context_t *c)
     return 0;
   }
 
-  return best_id;
+  uint32_t id_word = __builtin_ctz(c->active_words[best_id_prio]);
+  return id_word * 32 + __builtin_ctz(c->active[best_id_prio][id_word]);
+}
+
+void plic_t::update_first_enabled(uint32_t id_word)
+{
+  for (uint32_t id = id_word * 32; id < std::min(num_ids, (id_word + 1) * 32); id++) {
+    uint32_t id_mask = 1 << (id % 32);
+    first_enabled[id] = contexts.size();
+    for (size_t i = 0; i < contexts.size(); i++) {
+      if (contexts[i].enable[id_word] & id_mask) {
+        first_enabled[id] = i;
+        break;
+      }
+    }
+  }
 }
 
 void plic_t::context_update(const plic_context_t *c)
@@ -140,6 +178,7 @@ uint32_t plic_t::context_claim(plic_context_t *c)
   uint32_t best_id_mask = (1 << (best_id % 32));
 
   if (best_id) {
+    context_file(c, best_id, false);
     c->claimed[best_id_word] |= best_id_mask;
   }
 
@@ -177,7 +216,7 @@ bool plic_t::pending_read(reg_t offset, uint32_t *val)
 
   if (id_word < num_ids_word) {
     *val = 0;
-    for (auto context: contexts) {
+    for (const auto& context: contexts) {
         *val |= context.pending[id_word];
     }
   } else
@@ -220,6 +259,7 @@ bool plic_t::context_enable_write(plic_context_t *c,
     if (!(xor_val & id_mask)) {
       continue;
     }
+    context_file(c, id, false);
     if ((new_val & id_mask) &&
         (level[id_word] & id_mask)) {
       c->pending[id_word] |= id_mask;
@@ -229,8 +269,10 @@ bool plic_t::context_enable_write(plic_context_t *c,
       c->pending_priority[id] = 0;
       c->claimed[id_word] &= ~id_mask;
     }
+    context_refile(c, id);
   }
 
+  update_first_enabled(id_word);
   context_update(c);
   return true;
 }
@@ -270,7 +312,9 @@ bool plic_t::context_write(plic_context_t *c,
       uint32_t id_mask = 1 << (val % 32);
       if ((val < num_ids) &&
           (c->enable[id_word] & id_mask)) {
+        context_file(c, val, false);
         c->claimed[id_word] &= ~id_mask;
+        context_refile(c, val);
         update = true;
       }
       break;
@@ -309,21 +353,20 @@ void plic_t::set_interrupt_level(uint32_t id, int lvl)
    * handle this we auto-clear edge-triggered interrupts
    * when PLIC context CLAIM register is read.
    */
-  for (size_t i = 0; i < contexts.size(); i++) {
-    plic_context_t* c = &contexts[i];
+  if (first_enabled[id] < contexts.size()) {
+    plic_context_t* c = &contexts[first_enabled[id]];
 
-    if (c->enable[id_word] & id_mask) {
-      if (lvl) {
-        c->pending[id_word] |= id_mask;
-        c->pending_priority[id] = id_prio;
-      } else {
-        c->pending[id_word] &= ~id_mask;
-        c->pending_priority[id] = 0;
-        c->claimed[id_word] &= ~id_mask;
-      }
-      context_update(c);
-      break;
+    context_file(c, id, false);
+    if (lvl) {
+      c->pending[id_word] |= id_mask;
+      c->pending_priority[id] = id_prio;
+    } else {
+      c->pending[id_word] &= ~id_mask;
+      c->pending_priority[id] = 0;
+      c->claimed[id_word] &= ~id_mask;
     }
+    context_refile(c, id);
+    context_update(c);
   }
 }
 
@@ -426,6 +469,44 @@ std::string plic_generate_dts(const sim_t* sim, const std::vector<std::string>&
   return s.str();
 }
 
+void plic_t::save(std::ostream& o)
+{
+  checkpoint_put(o, priority);
+  checkpoint_put(o, level);
+  checkpoint_put(o, uint64_t(contexts.size()));
+  for (auto& c : contexts) {
+    checkpoint_put(o, c.priority_threshold);
+    checkpoint_put(o, c.enable);
+    checkpoint_put(o, c.pending);
+    checkpoint_put(o, c.pending_priority);
+    checkpoint_put(o, c.claimed);
+  }
+}
+
+void plic_t::restore(std::istream& i)
+{
+  checkpoint_get(i, priority);
+  checkpoint_get(i, level);
+  checkpoint_expect(i, uint64_t(contexts.size()), "PLIC contexts");
+  for (auto& c : contexts) {
+    checkpoint_get(i, c.priority_threshold);
+    checkpoint_get(i, c.enable);
+    checkpoint_get(i, c.pending);
+    checkpoint_get(i, c.pending_priority);
+    checkpoint_get(i, c.claimed);
+
+    memset(c.active, 0, sizeof(c.active));
+    memset(c.active_words, 0, sizeof(c.active_words));
+    c.active_levels = 0;
+    for (uint32_t id = 1; id < num_ids; id++)
+      context_refile(&c, id);
+    context_update(&c);
+  }
+
+  for (uint32_t id_word = 0; id_word < num_ids_word; id_word++)
+    update_first_enabled(id_word);
+}
+
 plic_t* plic_parse_from_fdt(const void* fdt, const sim_t* sim, reg_t* base, const std::vector<std::string>& sargs UNUSED)
 {
   uint32_t plic_ndev;
@@ -12,6 +12,9 @@
 #include "platform.h"
 #include "vector_unit.h"
 #include "debug_defines.h"
+#include "checkpoint.h"
+#include "decode_cache.h"
+#include "commit_log.h"
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
@@ -139,8 +142,10 @@ void processor_t::set_histogram(bool value)
   histogram_enabled = value;
 }
 
-void processor_t::enable_log_commits()
+void processor_t::enable_log_commits(commit_log_writer_t* binary_writer)
 {
+  if (binary_writer)
+    commit_log_encoder = std::make_unique<commit_log_encoder_t>(binary_writer, id);
   log_commits_enabled = true;
   mmu->flush_tlb(); // the TLB caches this setting
   build_opcode_map();
@@ -171,6 +176,159 @@ void processor_t::reset()
     sim->proc_reset(id);
 }
 
+// CSRs are saved through read() and restored through write(), in address
+// order, with V=0 so that virtualized CSRs name their HS-level copies.
+// Read-only CSRs are derived from other state and are skipped, as is seed,
+// whose reads have side effects.  Triggers are indexed through tselect and
+// are handled separately.
+static bool checkpoint_csr(reg_t addr)
+{
+  return get_field(addr, 0xC00) != 3 && addr != CSR_SEED &&
+         addr != CSR_TDATA1 && addr != CSR_TDATA2 && addr != CSR_TDATA3;
+}
+
+// More privileged CSRs limit what less privileged ones accept (mstateen and
+// sstateen, menvcfg and henvcfg), so restore them first.  pmpcfg can lock
+// the pmpaddr registers it guards, so restore it after them.  Writing fcsr
+// or the vector CSRs marks mstatus.FS/VS dirty, so the status registers go
+// last, with mstatus after its sstatus view.
+static reg_t checkpoint_csr_order(reg_t addr)
+{
+  if (addr == CSR_SSTATUS || addr == CSR_VSSTATUS)
+    return reg_t(PRV_M + 1) << 12;
+  if (addr == CSR_MSTATUS)
+    return (reg_t(PRV_M + 1) << 12) + 1;
+
+  reg_t order = addr;
+  if (addr >= CSR_PMPCFG0 && addr <= CSR_PMPCFG15)
+    order = CSR_PMPADDR63 + 1 + (addr - CSR_PMPCFG0);
+  return ((PRV_M - get_field(addr, 0x300)) << 12) | order;
+}
+
+void processor_t::save(std::ostream& o)
+{
+  checkpoint_put(o, state.pc);
+  for (size_t i = 0; i < NXPR; i++)
+    checkpoint_put(o, state.XPR[i]);
+  for (size_t i = 0; i < NFPR; i++)
+    checkpoint_put(o, state.FPR[i]);
+  checkpoint_put(o, state.prv);
+  checkpoint_put(o, state.v);
+  checkpoint_put(o, state.debug_mode);
+  checkpoint_put(o, state.elp);
+  checkpoint_put(o, state.critical_error);
+  checkpoint_put(o, in_wfi);
+
+  bool v = state.v;
+  state.v = false;
+  std::vector<std::pair<reg_t, reg_t>> csrs;
+  for (auto& [addr, csr] : state.csrmap)
+    if (checkpoint_csr(addr))
+      csrs.push_back({addr, csr->read()});
+  state.v = v;
+
+  checkpoint_put(o, uint64_t(csrs.size()));
+  for (auto& [addr, val] : csrs) {
+    checkpoint_put(o, addr);
+    checkpoint_put(o, val);
+  }
+  checkpoint_put(o, state.mip->read());
+
+  checkpoint_put(o, uint64_t(TM.count()));
+  for (unsigned i = 0; i < TM.count(); i++) {
+    checkpoint_put(o, TM.tdata1_read(i));
+    checkpoint_put(o, TM.tdata2_read(i));
+    checkpoint_put(o, TM.tdata3_read(i));
+  }
+
+  if (any_vector_extensions()) {
+    checkpoint_put(o, VU.vtype->read());
+    checkpoint_put(o, VU.vl->read());
+    o.write((const char*)VU.reg_file, NVPR * VU.vlenb);
+  }
+}
+
+void processor_t::restore(std::istream& i)
+{
+  checkpoint_get(i, state.pc);
+  for (size_t n = 0; n < NXPR; n++) {
+    reg_t val;
+    checkpoint_get(i, val);
+    state.XPR.write(n, val);
+  }
+  for (size_t n = 0; n < NFPR; n++) {
+    freg_t val;
+    checkpoint_get(i, val);
+    state.FPR.write(n, val);
+  }
+  reg_t prv;
+  bool v, debug_mode;
+  checkpoint_get(i, prv);
+  checkpoint_get(i, v);
+  checkpoint_get(i, debug_mode);
+  checkpoint_get(i, state.elp);
+  checkpoint_get(i, state.critical_error);
+  checkpoint_get(i, in_wfi);
+
+  uint64_t ncsrs;
+  checkpoint_get(i, ncsrs);
+  std::vector<std::pair<reg_t, reg_t>> csrs(ncsrs);
+  for (auto& [addr, val] : csrs) {
+    checkpoint_get(i, addr);
+    checkpoint_get(i, val);
+    if (!state.csrmap.count(addr))
+      throw std::runtime_error("checkpoint does not match this configuration: CSRs");
+  }
+  std::stable_sort(csrs.begin(), csrs.end(), [](auto& a, auto& b) {
+    return checkpoint_csr_order(a.first) < checkpoint_csr_order(b.first);
+  });
+
+  state.prv = PRV_M;
+  state.v = false;
+  state.debug_mode = true; // so that triggers with dmode set can be written
+  // fcsr and the vector CSRs can only be written while FS/VS are enabled
+  state.mstatus->write(state.mstatus->read() | MSTATUS_FS | MSTATUS_VS);
+  for (auto& [addr, val] : csrs)
+    state.csrmap[addr]->write(val);
+  // as after any counter write, the next bump must not count
+  state.minstret->bump(0);
+  state.mcycle->bump(0);
+
+  // the interrupt-pending bits driven by the CLINT; the PLIC and timers
+  // recompute theirs when the devices are restored
+  reg_t mip;
+  checkpoint_get(i, mip);
+  state.mip->backdoor_write_with_mask(MIP_MSIP | MIP_MTIP | MIP_MEIP, mip);
+
+  checkpoint_expect(i, uint64_t(TM.count()), "number of triggers");
+  for (unsigned n = 0; n < TM.count(); n++) {
+    reg_t tdata1, tdata2, tdata3;
+    checkpoint_get(i, tdata1);
+    checkpoint_get(i, tdata2);
+    checkpoint_get(i, tdata3);
+    TM.tdata1_write(n, tdata1);
+    TM.tdata2_write(n, tdata2);
+    TM.tdata3_write(n, tdata3);
+  }
+
+  if (any_vector_extensions()) {
+    reg_t vtype, vl;
+    checkpoint_get(i, vtype);
+    checkpoint_get(i, vl);
+    VU.set_vl(1, 1, vl, vtype);
+    if (!i.read((char*)VU.reg_file, NVPR * VU.vlenb))
+      throw std::runtime_error("checkpoint is truncated");
+  }
+
+  state.prv = prv;
+  state.v = v;
+  state.debug_mode = debug_mode;
+  state.serialized = false;
+  state.single_step = state.STEP_NONE;
+  mmu->yield_load_reservation();
+  mmu->flush_tlb();
+}
+
 extension_t* processor_t::get_extension()
 {
   switch (custom_extensions.size()) {
@@ -279,6 +437,14 @@ reg_t processor_t::select_an_interrupt_with_default_priority(reg_t enabled_inter
   return enabled_interrupts;
 }
 
+bool processor_t::is_idle() const
+{
+  // AIA adds interrupt sources beyond mip, so leave its harts alone.
+  return in_wfi && !state.debug_mode && halt_request == HR_NONE &&
+         !extension_enabled_const(EXT_SSAIA) &&
+         !(state.mip->read() & state.mie->read());
+}
+
 void processor_t::take_interrupt(reg_t pending_interrupts)
 {
   reg_t s_pending_interrupts = 0;
@@ -343,7 +509,7 @@ reg_t processor_t::legalize_privilege(reg_t prv)
 
 void processor_t::set_privilege(reg_t prv, bool virt)
 {
-  mmu->flush_tlb();
+  mmu->flush_tlb_context();
   state.prev_prv = state.prv;
   state.prev_v = state.v;
   state.prv = legalize_privilege(prv);
@@ -669,15 +835,28 @@ reg_t processor_t::throw_instruction_address_misaligned(reg_t pc)
 
 insn_func_t processor_t::decode_insn(insn_t insn)
 {
-  const auto& pool = opcode_map[insn.bits() % std::size(opcode_map)];
+  insn_bits_t bits = insn.bits();
+  const decode_node_t* node = &decode_tree[bits % std::size(opcode_map)];
+  while (node->bit >= 0)
+    node = &decode_tree[((bits >> node->bit) & 1) ? node->second : node->first];
 
-  for (auto p = pool.begin(); ; ++p) {
-    if ((insn.bits() & p->mask) == p->match) {
+  for (auto p = &decode_leaves[node->first]; ; ++p) {
+    if ((bits & p->mask) == p->match) {
       return p->func;
     }
   }
 }
 
+insn_func_t processor_t::decode_insn(insn_t insn, reg_t paddr)
+{
+  if (auto func = decode_cache_t::lookup(paddr, insn.bits(), decode_config))
+    return func;
+
+  auto func = decode_insn(insn);
+  decode_cache_t::insert(paddr, insn.bits(), decode_config, func);
+  return func;
+}
+
 void processor_t::register_insn(insn_desc_t desc, std::vector<insn_desc_t>& pool) {
   assert(desc.fast_rv32i && desc.fast_rv64i && desc.fast_rv32e && desc.fast_rv64e &&
          desc.logged_rv32i && desc.logged_rv64i && desc.logged_rv32e && desc.logged_rv64e);
@@ -685,6 +864,56 @@ void processor_t::register_insn(insn_desc_t desc, std::vector<insn_desc_t>& pool
   pool.push_back(desc);
 }
 
+// Split entries on the bit that divides them best, until few are left or no
+// bit helps.  An entry that ignores the bit goes to both sides, and each side
+// keeps the entries in order, so the first match is the same as in the list.
+void processor_t::build_decode_node(size_t node, const std::vector<opcode_map_entry_t>& entries)
+{
+  const size_t MAX_LEAF_ENTRIES = 4;
+
+  int best_bit = -1;
+  size_t best_size = entries.size();
+  if (entries.size() > MAX_LEAF_ENTRIES) {
+    for (int bit = 0; bit < int(8 * sizeof(insn_bits_t)); bit++) {
+      size_t n[2] = {0, 0};
+      for (auto& e : entries) {
+        if ((e.mask >> bit) & 1) {
+          n[(e.match >> bit) & 1]++;
+        } else {
+          n[0]++;
+          n[1]++;
+        }
+      }
+      if (std::max(n[0], n[1]) < best_size) {
+        best_size = std::max(n[0], n[1]);
+        best_bit = bit;
+      }
+    }
+  }
+
+  if (best_bit < 0) {
+    decode_tree[node] = {-1, uint32_t(decode_leaves.size()), uint32_t(decode_leaves.size() + entries.size())};
+    decode_leaves.insert(decode_leaves.end(), entries.begin(), entries.end());
+    return;
+  }
+
+  std::vector<opcode_map_entry_t> sides[2];
+  for (auto& e : entries) {
+    if ((e.mask >> best_bit) & 1) {
+      sides[(e.match >> best_bit) & 1].push_back(e);
+    } else {
+      sides[0].push_back(e);
+      sides[1].push_back(e);
+    }
+  }
+
+  size_t children = decode_tree.size();
+  decode_tree.resize(children + 2);
+  decode_tree[node] = {best_bit, uint32_t(children), uint32_t(children + 1)};
+  build_decode_node(children, sides[0]);
+  build_decode_node(children + 1, sides[1]);
+}
+
 void processor_t::build_opcode_map()
 {
   bool rve = extension_enabled('E');
@@ -711,6 +940,13 @@ void processor_t::build_opcode_map()
 
   for (auto& d : instructions)
     build_one(d);
+
+  decode_tree.assign(N, {});
+  decode_leaves.clear();
+  for (size_t i = 0; i < N; i++)
+    build_decode_node(i, opcode_map[i]);
+
+  decode_config = decode_cache_t::config_id(opcode_map, N);
 }
 
 void processor_t::register_extension(extension_t *x) {
@@ -9,6 +9,7 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <memory>
 #include <cassert>
 #include "debug_rom_defines.h"
 #include "entropy_source.h"
@@ -28,6 +29,8 @@ class simif_t;
 class trap_t;
 class extension_t;
 class disassembler_t;
+class commit_log_writer_t;
+class commit_log_encoder_t;
 
 reg_t illegal_instruction(processor_t* p, insn_t insn, reg_t pc);
 
@@ -68,6 +71,15 @@ struct opcode_map_entry_t
   insn_func_t func;
 };
 
+// A node of the decode tree built from opcode_map.  Inner nodes branch on
+// one bit of the instruction; leaves hold the few entries that can still
+// match, in opcode_map order.
+struct decode_node_t
+{
+  int bit; // -1 for a leaf
+  uint32_t first, second; // children, or the leaf's range of decode_leaves
+};
+
 // regnum, data
 typedef std::map<reg_t, freg_t> commit_log_reg_t;
 
@@ -239,9 +251,13 @@ public:
 
   void set_debug(bool value);
   void set_histogram(bool value);
-  void enable_log_commits();
+  // With a writer, commits are logged in the binary format of commit_log.h.
+  void enable_log_commits(commit_log_writer_t* binary_writer = nullptr);
   bool get_log_commits_enabled() const { return log_commits_enabled; }
+  commit_log_encoder_t* get_commit_log_encoder() { return commit_log_encoder.get(); }
   void reset();
+  void save(std::ostream& o) override;
+  void restore(std::istream& i) override;
   void step(size_t n); // run for n cycles
   void put_csr(int which, reg_t val);
   uint32_t get_id() const { return id; }
@@ -357,6 +373,9 @@ public:
 
   void clear_waiting_for_interrupt() { in_wfi = false; };
   bool is_waiting_for_interrupt() { return in_wfi; };
+  // in WFI with nothing pending that could wake it, so that only a change
+  // of mip can make it run again
+  bool is_idle() const;
 
   void check_if_lpad_required();
   reg_t set_lpad_expected(reg_t pc);
@@ -378,6 +397,7 @@ private:
   bool histogram_enabled;
   bool log_commits_enabled;
   FILE *log_file;
+  std::unique_ptr<commit_log_encoder_t> commit_log_encoder;
   std::ostream sout_; // needed for socket command interface -s, also used for -d and -l, but not for --log
   bool halt_on_reset;
   bool in_wfi;
@@ -390,6 +410,11 @@ private:
   mutable std::bitset<NUM_ISA_EXTENSIONS> extension_assumed_const;
 
   std::vector<opcode_map_entry_t> opcode_map[128];
+  // decode_tree[i] is the root of the tree for opcode_map[i]
+  std::vector<decode_node_t> decode_tree;
+  std::vector<opcode_map_entry_t> decode_leaves;
+  void build_decode_node(size_t node, const std::vector<opcode_map_entry_t>& entries);
+  uint32_t decode_config; // decode_cache_t::config_id() of opcode_map
   std::vector<insn_desc_t> instructions;
   std::vector<insn_desc_t> custom_instructions;
   std::unordered_map<reg_t,uint64_t> pc_histogram;
@@ -413,6 +438,8 @@ private:
   void parse_priv_string(const char*);
   void register_base_instructions();
   insn_func_t decode_insn(insn_t insn);
+  // the same, for an instruction fetched from paddr, through decode_cache_t
+  insn_func_t decode_insn(insn_t insn, reg_t paddr);
 
   // Track repeated executions for processor_t::disasm()
   uint64_t last_pc, last_bits, executions;
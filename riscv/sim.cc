@@ -10,6 +10,8 @@
 #include "platform.h"
 #include "libfdt.h"
 #include "socketif.h"
+#include "hart_threads.h"
+#include "commit_log.h"
 #include <fstream>
 #include <map>
 #include <iostream>
@@ -57,6 +59,7 @@ sim_t::sim_t(const cfg_t *cfg, bool halted,
     cmd_file(cmd_file),
     instruction_limit(instruction_limit),
     sout_(nullptr),
+    quantum(INTERLEAVE),
     current_step(0),
     current_proc(0),
     debug(false),
@@ -107,7 +110,7 @@ sim_t::sim_t(const cfg_t *cfg, bool halted,
       harts[cfg->hartids[i]] = procs[i];
     }
     for (auto& x : mems) {
-      bus.add_device(x.first, x.second);
+      add_mem(x.first, x.second);
     }
     for (auto& pair : harts) {
       if (auto pc = cfg->start_pc.get(pair.first)) {
@@ -264,7 +267,7 @@ sim_t::sim_t(const cfg_t *cfg, bool halted,
 
   for (auto& x : mems)
   {
-      bus.add_device(x.first, x.second);
+      add_mem(x.first, x.second);
   }
 
   // must be located after procs/harts are set (devices might use sim_t get_* member functions)
@@ -299,6 +302,7 @@ sim_t::sim_t(const cfg_t *cfg, bool halted,
 
 sim_t::~sim_t()
 {
+  hart_threads.reset();
   for (size_t i = 0; i < procs.size(); i++)
     delete procs[i];
   delete debug_mmu;
@@ -311,6 +315,18 @@ int sim_t::run()
 
   htif_t::set_expected_xlen(harts.begin()->second->get_isa().get_max_xlen());
 
+  if (cfg->parallel_harts && procs.size() > 1) {
+    // Ziccid keeps instruction fetch coherent by flushing other harts'
+    // TLBs from within a store, which cannot be done from another thread.
+    for (auto p : procs) {
+      if (p->extension_enabled(EXT_ZICCID)) {
+        std::cerr << "--parallel-harts is not compatible with Ziccid" << std::endl;
+        exit(1);
+      }
+    }
+    hart_threads.reset(new hart_threads_t(procs.size()));
+  }
+
   // htif_t::run() will repeatedly call back into sim_t::idle(), each
   // invocation of which will advance target time
   return htif_t::run();
@@ -318,24 +334,106 @@ int sim_t::run()
 
 void sim_t::step(size_t n)
 {
+  if (hart_threads) {
+    step_parallel(n);
+    return;
+  }
+
   for (size_t i = 0, steps = 0; i < n; i += steps)
   {
-    steps = std::min(n - i, INTERLEAVE - current_step);
+    if (current_step == 0 && current_proc == 0) {
+      skip_idle_time();
+      quantum = next_quantum();
+    }
+
+    steps = std::min(n - i, quantum - current_step);
     procs[current_proc]->step(steps);
 
     current_step += steps;
-    if (current_step == INTERLEAVE)
+    if (current_step == quantum)
     {
       current_step = 0;
       procs[current_proc]->get_mmu()->yield_load_reservation();
       if (++current_proc == procs.size()) {
         current_proc = 0;
-        reg_t rtc_ticks = INTERLEAVE / INSNS_PER_RTC_TICK;
+        reg_t rtc_ticks = quantum / INSNS_PER_RTC_TICK;
         for (auto &dev : devices) dev->tick(rtc_ticks);
       }
     }
   }
 }
+
+// Every hart runs for INTERLEAVE instructions in turn, after which the
+// devices are ticked, unless a device has an event due sooner: then the
+// quantum ends with the tick on which it falls due.
+size_t sim_t::next_quantum()
+{
+  reg_t rtc_ticks = INTERLEAVE / INSNS_PER_RTC_TICK;
+  for (auto &dev : devices)
+    rtc_ticks = std::min(rtc_ticks, dev->next_event());
+
+  return std::max<reg_t>(rtc_ticks, 1) * INSNS_PER_RTC_TICK;
+}
+
+// When every hart is idle in WFI, nothing changes until a device event, so
+// move time on to the tick before the earliest one without stepping the
+// harts.  The devices are still ticked at least once per INTERLEAVE
+// quantum, so that those without scheduled events, such as a UART polling
+// the terminal, are polled as often in target time, and the skip stops as
+// soon as one of them wakes a hart.  The next quantum then ends on the
+// event.  Harts count no cycles while in WFI, so skipping is invisible to
+// them but for the host time saved.  Each call skips at most
+// MAX_IDLE_SKIP_QUANTA quanta, so that idle() still gets to poll HTIF and
+// the remote bitbang port during a long wait.
+void sim_t::skip_idle_time()
+{
+  const reg_t max_ticks = INTERLEAVE / INSNS_PER_RTC_TICK;
+
+  for (size_t i = 0; i < MAX_IDLE_SKIP_QUANTA && !ctrlc_pressed; i++) {
+    for (auto p : procs) {
+      if (!p->is_idle())
+        return;
+    }
+
+    reg_t rtc_ticks = UINT64_MAX;
+    for (auto &dev : devices)
+      rtc_ticks = std::min(rtc_ticks, dev->next_event());
+
+    if (rtc_ticks == UINT64_MAX || rtc_ticks <= 1)
+      return;
+
+    rtc_ticks = std::min(rtc_ticks - 1, max_ticks);
+    for (auto &dev : devices)
+      dev->tick(rtc_ticks);
+  }
+}
+
+// Every hart runs the same number of instructions on its own thread.  The
+// devices are only ticked here, between quanta, while all harts are
+// stopped, so they see the same time base as in the sequential schedule.
+void sim_t::step_parallel(size_t n)
+{
+  for (size_t i = 0, steps = 0; i < n; i += steps)
+  {
+    if (current_step == 0) {
+      skip_idle_time();
+      quantum = next_quantum();
+    }
+
+    steps = std::min(n - i, quantum - current_step);
+    hart_threads->run([&](size_t id) { procs[id]->step(steps); });
+
+    current_step += steps;
+    if (current_step == quantum)
+    {
+      current_step = 0;
+      for (auto p : procs)
+        p->get_mmu()->yield_load_reservation();
+      reg_t rtc_ticks = quantum / INSNS_PER_RTC_TICK;
+      for (auto &dev : devices) dev->tick(rtc_ticks);
+    }
+  }
+}
 const char* sim_t::get_dts() {
   dts = dtb_to_dts(dtb);
   return dts.c_str(); 
@@ -345,6 +443,23 @@ void sim_t::add_device(reg_t addr, std::shared_ptr<abstract_device_t> dev) {
   devices.push_back(dev);
 }
 
+void sim_t::add_mem(reg_t addr, abstract_mem_t* mem) {
+  bus.add_device(addr, mem);
+  if (auto contents = mem->flat_contents(); contents && addr % PGSIZE == 0)
+    flat_mems.push_back({addr, mem->size(), contents});
+}
+
+void sim_t::set_checkpoint(unsigned long long n, const std::string& path)
+{
+  checkpoint_at = n;
+  checkpoint_path = path;
+}
+
+void sim_t::set_restore(const std::string& path)
+{
+  restore_path = path;
+}
+
 void sim_t::set_debug(bool value)
 {
   debug = value;
@@ -358,15 +473,18 @@ void sim_t::set_histogram(bool value)
   }
 }
 
-void sim_t::configure_log(bool enable_log, bool enable_commitlog)
+void sim_t::configure_log(bool enable_log, bool enable_commitlog, bool binary_commitlog)
 {
   log = enable_log;
 
   if (!enable_commitlog)
     return;
 
+  if (binary_commitlog)
+    commit_log_writer = std::make_unique<commit_log_writer_t>(log_file.get());
+
   for (processor_t *proc : procs) {
-    proc->enable_log_commits();
+    proc->enable_log_commits(commit_log_writer.get());
   }
 }
 
@@ -381,10 +499,26 @@ bool sim_t::is_debug_module_access(reg_t paddr, size_t len)
   return bus.find_device(paddr, len).second == &debug_module;
 }
 
+std::pair<reg_t, abstract_device_t*> sim_t::find_mmio_device(reg_t paddr)
+{
+  // Direct calls would bypass bus_lock, and the debug module is only
+  // accessible in debug mode, which mmu_t::mmio_ok() checks.
+  if (cfg->parallel_harts || is_async())
+    return std::make_pair(0, nullptr);
+
+  auto [base, dev] = bus.find_device(paddr, 1);
+  if (dev == &debug_module)
+    return std::make_pair(0, nullptr);
+  return std::make_pair(base, dev);
+}
+
 bool sim_t::mmio_load(reg_t paddr, size_t len, uint8_t* bytes)
 {
   if (paddr + len < paddr)
     return false;
+  std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+  if (bus_shared())
+    lock.lock();
   return bus.load(paddr, len, bytes);
 }
 
@@ -392,6 +526,9 @@ bool sim_t::mmio_store(reg_t paddr, size_t len, const uint8_t* bytes)
 {
   if (paddr + len < paddr)
     return false;
+  std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+  if (bus_shared())
+    lock.lock();
   return bus.store(paddr, len, bytes);
 }
 
@@ -441,9 +578,18 @@ void sim_t::set_rom()
 }
 
 char* sim_t::addr_to_mem(reg_t paddr) {
+  for (auto& mem : flat_mems) {
+    if (paddr - mem.base < mem.size)
+      return mem.contents + (paddr - mem.base);
+  }
+
   auto page_offset = paddr % PGSIZE;
   auto page_addr = paddr - page_offset;
 
+  std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+  if (bus_shared())
+    lock.lock();
+
   if (auto it = addr_to_mem_cache.find(page_addr); it != addr_to_mem_cache.end())
     return it->second + page_offset;
 
@@ -468,6 +614,9 @@ void sim_t::reset()
 {
   if (dtb_enabled)
     set_rom();
+
+  if (!restore_path.empty())
+    restore_checkpoint(restore_path);
 }
 
 void sim_t::idle()
@@ -478,6 +627,20 @@ void sim_t::idle()
   if (debug || ctrlc_pressed)
     interactive();
   else {
+    if (checkpoint_at.has_value() && *checkpoint_at < INTERLEAVE &&
+        (!instruction_limit.has_value() || *checkpoint_at <= *instruction_limit)) {
+      // Stop at exactly the requested instruction; the next call picks the
+      // quantum up from there.
+      step(*checkpoint_at);
+      if (instruction_limit.has_value())
+        *instruction_limit -= *checkpoint_at;
+      save_checkpoint(checkpoint_path);
+      checkpoint_at.reset();
+      return;
+    }
+    if (checkpoint_at.has_value())
+      *checkpoint_at -= std::min<unsigned long long>(*checkpoint_at, INTERLEAVE);
+
     if (instruction_limit.has_value()) {
       if (*instruction_limit < INTERLEAVE) {
         // Final step.
@@ -495,19 +658,93 @@ void sim_t::idle()
     remote_bitbang->tick();
 }
 
+// Chunks are copied a page at a time, straight to or from the host memory
+// behind RAM pages.  Other pages go through debug_mmu a doubleword at a
+// time, so that devices see the accesses they always have.
 void sim_t::read_chunk(addr_t taddr, size_t len, void* dst)
 {
-  assert(len == 8);
-  auto data = debug_mmu->to_target(debug_mmu->load<uint64_t>(taddr));
-  memcpy(dst, &data, sizeof data);
+  assert(len % 8 == 0 && taddr % 8 == 0);
+  for (size_t pos = 0, n; pos < len; pos += n) {
+    reg_t addr = taddr + pos;
+    n = std::min<size_t>(len - pos, PGSIZE - addr % PGSIZE);
+    if (char* host_addr = addr_to_mem(addr)) {
+      memcpy((char*)dst + pos, host_addr, n);
+      continue;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+    if (bus_shared())
+      lock.lock();
+    for (size_t i = 0; i < n; i += 8) {
+      auto data = debug_mmu->to_target(debug_mmu->load<uint64_t>(addr + i));
+      memcpy((char*)dst + pos + i, &data, sizeof data);
+    }
+  }
 }
 
 void sim_t::write_chunk(addr_t taddr, size_t len, const void* src)
 {
-  assert(len == 8);
-  target_endian<uint64_t> data;
-  memcpy(&data, src, sizeof data);
-  debug_mmu->store<uint64_t>(taddr, debug_mmu->from_target(data));
+  assert(len % 8 == 0 && taddr % 8 == 0);
+  for (size_t pos = 0, n; pos < len; pos += n) {
+    reg_t addr = taddr + pos;
+    n = std::min<size_t>(len - pos, PGSIZE - addr % PGSIZE);
+    if (char* host_addr = addr_to_mem(addr)) {
+      // with harts on their own threads, take the store sequence numbers,
+      // so that an LR/SC pair across this store fails
+      if (hart_threads)
+        debug_mmu->shared_host_store((uintptr_t)host_addr, (const char*)src + pos, n);
+      else
+        memcpy(host_addr, (const char*)src + pos, n);
+      continue;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+    if (bus_shared())
+      lock.lock();
+    for (size_t i = 0; i < n; i += 8) {
+      target_endian<uint64_t> data;
+      memcpy(&data, (const char*)src + pos + i, sizeof data);
+      debug_mmu->store<uint64_t>(addr + i, debug_mmu->from_target(data));
+    }
+  }
+}
+
+void sim_t::clear_chunk(addr_t taddr, size_t len)
+{
+  assert(len % 8 == 0 && taddr % 8 == 0);
+  // clear() bypasses the store sequence numbers that harts on their own
+  // threads rely on, so then clear page by page as write_chunk() stores
+  auto [base, dev] = bus.find_device(taddr, len);
+  if (auto mem = dynamic_cast<abstract_mem_t*>(dev); mem && !hart_threads) {
+    mem->clear(taddr - base, len);
+    return;
+  }
+
+  static const char zeros[PGSIZE] = {};
+  for (size_t pos = 0, n; pos < len; pos += n) {
+    reg_t addr = taddr + pos;
+    n = std::min<size_t>(len - pos, PGSIZE - addr % PGSIZE);
+    if (char* host_addr = addr_to_mem(addr)) {
+      if (hart_threads)
+        debug_mmu->shared_host_store((uintptr_t)host_addr, zeros, n);
+      else
+        memset(host_addr, 0, n);
+      continue;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(bus_lock, std::defer_lock);
+    if (bus_shared())
+      lock.lock();
+    for (size_t i = 0; i < n; i += 8)
+      debug_mmu->store<uint64_t>(addr + i, 0);
+  }
+}
+
+bool sim_t::map_chunk(addr_t taddr, size_t len, int fd, off_t offset)
+{
+  auto [base, dev] = bus.find_device(taddr, len);
+  auto mem = dynamic_cast<abstract_mem_t*>(dev);
+  return mem && mem->map_file(taddr - base, len, fd, offset);
 }
 
 endianness_t sim_t::get_target_endianness() const
@@ -17,10 +17,13 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <sys/types.h>
 
 class mmu_t;
 class remote_bitbang_t;
+class hart_threads_t;
+class commit_log_writer_t;
 class socketif_t;
 
 // Type for holding a pair of device factory and device specialization arguments.
@@ -45,13 +48,17 @@ public:
   int run();
   void set_debug(bool value);
   void set_histogram(bool value);
+  // Save a checkpoint to path after n instructions have been simulated.
+  void set_checkpoint(unsigned long long n, const std::string& path);
+  // Restore the checkpoint at path once the target program is loaded.
+  void set_restore(const std::string& path);
   void add_device(reg_t addr, std::shared_ptr<abstract_device_t> dev);
 
   // Configure logging
   //
   // If enable_log is true, an instruction trace will be generated. If
   // enable_commitlog is true, so will the commit results
-  void configure_log(bool enable_log, bool enable_commitlog);
+  void configure_log(bool enable_log, bool enable_commitlog, bool binary_commitlog = false);
 
   void set_procs_debug(bool value);
   void set_remote_bitbang(remote_bitbang_t* remote_bitbang) {
@@ -62,6 +69,7 @@ public:
   abstract_interrupt_controller_t* get_intctrl() const { assert(plic.get()); return plic.get(); }
   virtual const cfg_t &get_cfg() const override { return *cfg; }
   virtual bool is_debug_module_access(reg_t paddr, size_t len) override;
+  virtual std::pair<reg_t, abstract_device_t*> find_mmio_device(reg_t paddr) override;
 
   virtual const std::map<size_t, processor_t*>& get_harts() const override { return harts; }
   const bus_t& get_bus() const {  return bus;}
@@ -71,6 +79,7 @@ public:
 
   static const size_t INTERLEAVE = 5000;
   static const size_t INSNS_PER_RTC_TICK = 100; // 10 MHz clock for 1 BIPS core
+  static const size_t MAX_IDLE_SKIP_QUANTA = 1000; // per call of skip_idle_time()
   static const size_t CPU_HZ = 1000000000; // 1GHz CPU
 
 private:
@@ -79,6 +88,14 @@ private:
   std::vector<processor_t*> procs;
   std::map<size_t, processor_t*> harts;
   std::unordered_map<reg_t, char*> addr_to_mem_cache;
+  // memories backed by one host buffer, which addr_to_mem() translates
+  // without consulting the bus or the cache above
+  struct flat_mem_t {
+    reg_t base;
+    reg_t size;
+    char* contents;
+  };
+  std::vector<flat_mem_t> flat_mems;
   std::pair<reg_t, reg_t> initrd_range;
   std::string dts;
   std::string dtb;
@@ -89,16 +106,29 @@ private:
   std::shared_ptr<plic_t> plic;
   bus_t bus;
   log_file_t log_file;
+  // declared after log_file so that it is drained before the file closes
+  std::unique_ptr<commit_log_writer_t> commit_log_writer;
 
   FILE *cmd_file; // pointer to debug command input file
 
   std::optional<unsigned long long> instruction_limit;
 
+  std::optional<unsigned long long> checkpoint_at;
+  std::string checkpoint_path;
+  std::string restore_path;
+  void save_checkpoint(const std::string& path);
+  void restore_checkpoint(const std::string& path);
+
   socketif_t *socketif;
   std::ostream sout_; // used for socket and terminal interface
 
   processor_t* get_core(const std::string& i);
+  void add_mem(reg_t addr, abstract_mem_t* mem);
   void step(size_t n); // step through simulation
+  void step_parallel(size_t n);
+  size_t next_quantum();
+  void skip_idle_time();
+  size_t quantum; // instructions per hart until the devices are next ticked
   size_t current_step;
   size_t current_proc;
   bool debug;
@@ -107,6 +137,16 @@ private:
   remote_bitbang_t* remote_bitbang;
   std::optional<std::function<void()>> next_interactive_action;
 
+  // With --parallel-harts, every hart runs its quantum on its own host
+  // thread.  The bus and the paddr-to-host cache are then shared between
+  // threads and guarded by bus_lock (recursive because the debug module
+  // reaches memory through debug_mmu while servicing a bus access).  The
+  // same goes for --async-htif, whose service thread reaches devices and
+  // debug_mmu through read_chunk() and write_chunk().
+  std::unique_ptr<hart_threads_t> hart_threads;
+  std::recursive_mutex bus_lock;
+  bool bus_shared() const { return hart_threads || is_async(); }
+
   // If padd corresponds to memory (as opposed to an I/O device), return a
   // host pointer corresponding to paddr.
   // For these purposes, only memories that include the entire base page
@@ -160,8 +200,13 @@ private:
   virtual void idle() override;
   virtual void read_chunk(addr_t taddr, size_t len, void* dst) override;
   virtual void write_chunk(addr_t taddr, size_t len, const void* src) override;
+  virtual void clear_chunk(addr_t taddr, size_t len) override;
+  virtual bool map_chunk(addr_t taddr, size_t len, int fd, off_t offset) override;
+  virtual char* chunk_host_addr(addr_t taddr) override { return addr_to_mem(taddr); }
   virtual size_t chunk_align() override { return 8; }
-  virtual size_t chunk_max_size() override { return 8; }
+  // The chunk routines split transfers into pages themselves, so memif_t
+  // can hand them whole buffers.
+  virtual size_t chunk_max_size() override { return size_t(1) << 30; }
   virtual endianness_t get_target_endianness() const override;
 
 public:
@@ -9,6 +9,7 @@
 
 class processor_t;
 class mmu_t;
+class abstract_device_t;
 
 // this is the interface to the simulator used by the processors and memory
 class simif_t
@@ -22,6 +23,10 @@ public:
   virtual bool mmio_load(reg_t paddr, size_t len, uint8_t* bytes) = 0;
   virtual bool mmio_store(reg_t paddr, size_t len, const uint8_t* bytes) = 0;
   virtual bool is_debug_module_access(reg_t, size_t) { return false; }
+  // the base address of the device at paddr and the device itself, if the
+  // MMU may call its load() and store() directly rather than through
+  // mmio_load() and mmio_store(); nullptr otherwise
+  virtual std::pair<reg_t, abstract_device_t*> find_mmio_device(reg_t) { return std::make_pair(0, nullptr); }
   // Callback for processors to let the simulation know they were reset.
   virtual void proc_reset(unsigned id) = 0;
 
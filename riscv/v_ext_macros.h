@@ -219,6 +219,81 @@ static inline bool is_overlapped_widen(const int astart, int asize,
   if (is_over) \
     require(insn.rd() != insn.rs2()); \
 
+//
+// vector: fast path for unmasked loops that start at element 0, which is
+// how most vector code runs.  SEW is dispatched once per instruction rather
+// than per element, and the register groups are indexed directly, so the
+// compiler can vectorize BODY for the host.  Elements are visited in the
+// same order as by the general loop, so the results are identical.
+//
+#define VI_FAST_VV_OPERANDS(T) \
+  const T *vs1_base = P.VU.elt_span<T>(rs1_num, vl);
+
+#define VI_FAST_VV_OPERAND(T) \
+  T vs1 = vs1_base[i];
+
+#define VI_FAST_VX_OPERANDS(T) \
+  T rs1 = (T)RS1;
+
+#define VI_FAST_VX_OPERAND(T)
+
+#define VI_FAST_VI_OPERANDS(T) \
+  T UNUSED simm5 = (T)insn.v_simm5(); \
+  T UNUSED zimm5 = (T)insn.v_zimm5();
+
+#define VI_FAST_VI_OPERAND(T)
+
+#define VI_FAST_LOOP_SSS(T, VS1, BODY) \
+  VI_FAST_##VS1##_OPERANDS(T) \
+  const T *vs2_base = P.VU.elt_span<T>(rs2_num, vl); \
+  T *vd_base = P.VU.elt_span<T>(rd_num, vl, true); \
+  for (reg_t i = 0; i < vl; ++i) { \
+    VI_FAST_##VS1##_OPERAND(T) \
+    T UNUSED vs2 = vs2_base[i]; \
+    T UNUSED &vd = vd_base[i]; \
+    BODY; \
+  }
+
+#define VI_FAST_LOOP_CMP(T, VS1, BODY) \
+  VI_FAST_##VS1##_OPERANDS(T) \
+  const T *vs2_base = P.VU.elt_span<T>(rs2_num, vl); \
+  uint8_t *vd_base = P.VU.elt_span<uint8_t>(rd_num, (vl + 7) / 8, true); \
+  for (reg_t i = 0; i < vl; ++i) { \
+    VI_FAST_##VS1##_OPERAND(T) \
+    T vs2 = vs2_base[i]; \
+    bool res = false; \
+    BODY; \
+    vd_base[i / 8] = (vd_base[i / 8] & ~(1U << (i % 8))) | (res << (i % 8)); \
+  }
+
+// Takes the fast path if it can, else runs the statement that follows.
+#ifdef WORDS_BIGENDIAN
+#define VI_FAST_LOOP(TYPE, VS1, LOOP, BODY)
+#else
+#define VI_FAST_LOOP(TYPE, VS1, LOOP, BODY) \
+  if (insn.v_vm() == 1 && P.VU.vstart->read() == 0) { \
+    require(P.VU.vsew >= e8 && P.VU.vsew <= e64); \
+    require_vector(true); \
+    reg_t vl = P.VU.vl->read(); \
+    reg_t UNUSED sew = P.VU.vsew; \
+    reg_t UNUSED rd_num = insn.rd(); \
+    reg_t UNUSED rs1_num = insn.rs1(); \
+    reg_t rs2_num = insn.rs2(); \
+    if (vl > 0) { \
+      if (sew == e8) { \
+        LOOP(TYPE<e8>::type, VS1, BODY) \
+      } else if (sew == e16) { \
+        LOOP(TYPE<e16>::type, VS1, BODY) \
+      } else if (sew == e32) { \
+        LOOP(TYPE<e32>::type, VS1, BODY) \
+      } else if (sew == e64) { \
+        LOOP(TYPE<e64>::type, VS1, BODY) \
+      } \
+    } \
+    VECTOR_END; \
+  } else
+#endif
+
 //
 // vector: loop header and end helper
 //
@@ -508,34 +583,36 @@ static inline bool is_overlapped_widen(const int astart, int asize,
   }
 
 // comparison result to masking register
-#define VI_LOOP_CMP_BODY(PARAMS, BODY) \
-  VI_LOOP_CMP_BASE \
-  INSNS_BASE(PARAMS, BODY) \
-  VI_LOOP_CMP_END
+#define VI_LOOP_CMP_BODY(PARAMS, TYPE, VS1, BODY) \
+  VI_FAST_LOOP(TYPE, VS1, VI_FAST_LOOP_CMP, BODY) { \
+    VI_LOOP_CMP_BASE \
+    INSNS_BASE(PARAMS, BODY) \
+    VI_LOOP_CMP_END \
+  }
 
 #define VI_VV_LOOP_CMP(BODY) \
   VI_CHECK_MSS(true); \
-  VI_LOOP_CMP_BODY(VV_CMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VV_CMP_PARAMS, type_sew_t, VV, BODY)
 
 #define VI_VX_LOOP_CMP(BODY) \
   VI_CHECK_MSS(false); \
-  VI_LOOP_CMP_BODY(VX_CMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VX_CMP_PARAMS, type_sew_t, VX, BODY)
 
 #define VI_VI_LOOP_CMP(BODY) \
   VI_CHECK_MSS(false); \
-  VI_LOOP_CMP_BODY(VI_CMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VI_CMP_PARAMS, type_sew_t, VI, BODY)
 
 #define VI_VV_ULOOP_CMP(BODY) \
   VI_CHECK_MSS(true); \
-  VI_LOOP_CMP_BODY(VV_UCMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VV_UCMP_PARAMS, type_usew_t, VV, BODY)
 
 #define VI_VX_ULOOP_CMP(BODY) \
   VI_CHECK_MSS(false); \
-  VI_LOOP_CMP_BODY(VX_UCMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VX_UCMP_PARAMS, type_usew_t, VX, BODY)
 
 #define VI_VI_ULOOP_CMP(BODY) \
   VI_CHECK_MSS(false); \
-  VI_LOOP_CMP_BODY(VI_UCMP_PARAMS, BODY)
+  VI_LOOP_CMP_BODY(VI_UCMP_PARAMS, type_usew_t, VI, BODY)
 
 // merge and copy loop
 #define VI_MERGE_VARS \
@@ -681,39 +758,43 @@ static inline bool is_overlapped_widen(const int astart, int asize,
 // genearl VXI signed/unsigned loop
 #define VI_VV_ULOOP(BODY) \
   VI_CHECK_SSS(true) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VV_U_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VV_U_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VV_U_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VV_U_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_usew_t, VV, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VV_U_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VV_U_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VV_U_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VV_U_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 #define VI_VV_LOOP(BODY) \
   VI_CHECK_SSS(true) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VV_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VV_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VV_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VV_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_sew_t, VV, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VV_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VV_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VV_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VV_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 #define VI_V_ULOOP(BODY) \
   VI_CHECK_SSS(false) \
@@ -753,75 +834,83 @@ static inline bool is_overlapped_widen(const int astart, int asize,
 
 #define VI_VX_ULOOP(BODY) \
   VI_CHECK_SSS(false) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VX_U_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VX_U_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VX_U_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VX_U_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_usew_t, VX, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VX_U_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VX_U_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VX_U_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VX_U_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 #define VI_VX_LOOP(BODY) \
   VI_CHECK_SSS(false) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VX_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VX_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VX_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VX_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_sew_t, VX, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VX_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VX_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VX_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VX_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 #define VI_VI_ULOOP(BODY) \
   VI_CHECK_SSS(false) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VI_U_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VI_U_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VI_U_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VI_U_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_usew_t, VI, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VI_U_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VI_U_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VI_U_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VI_U_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 #define VI_VI_LOOP(BODY) \
   VI_CHECK_SSS(false) \
-  VI_LOOP_BASE \
-  if (sew == e8) { \
-    VI_PARAMS(e8); \
-    BODY; \
-  } else if (sew == e16) { \
-    VI_PARAMS(e16); \
-    BODY; \
-  } else if (sew == e32) { \
-    VI_PARAMS(e32); \
-    BODY; \
-  } else if (sew == e64) { \
-    VI_PARAMS(e64); \
-    BODY; \
-  } \
-  VI_LOOP_END
+  VI_FAST_LOOP(type_sew_t, VI, VI_FAST_LOOP_SSS, BODY) { \
+    VI_LOOP_BASE \
+    if (sew == e8) { \
+      VI_PARAMS(e8); \
+      BODY; \
+    } else if (sew == e16) { \
+      VI_PARAMS(e16); \
+      BODY; \
+    } else if (sew == e32) { \
+      VI_PARAMS(e32); \
+      BODY; \
+    } else if (sew == e64) { \
+      VI_PARAMS(e64); \
+      BODY; \
+    } \
+    VI_LOOP_END \
+  }
 
 // signed unsigned operation loop (e.g. mulhsu)
 #define VI_VV_SU_LOOP(BODY) \
@@ -1236,12 +1325,14 @@ VI_VX_ULOOP({ \
 #define VI_STRIP(inx) \
   reg_t vreg_inx = inx;
 
-#define VI_LD(stride, offset, elt_width, is_mask_ldst) \
+#define VI_LD_BASE(elt_width, is_mask_ldst) \
   const reg_t nf = insn.v_nf() + 1; \
   VI_CHECK_LOAD(elt_width, is_mask_ldst); \
   const reg_t vl = is_mask_ldst ? ((P.VU.vl->read() + 7) / 8) : P.VU.vl->read(); \
   const reg_t baseAddr = RS1; \
-  const reg_t vd = insn.rd(); \
+  const reg_t vd = insn.rd();
+
+#define VI_LD_LOOP(stride, offset, elt_width) \
   for (reg_t i = 0; i < vl; ++i) { \
     VI_ELEMENT_SKIP; \
     VI_STRIP(i); \
@@ -1251,7 +1342,11 @@ VI_VX_ULOOP({ \
         baseAddr + (stride) + (offset) * sizeof(elt_width##_t)); \
       P.VU.elt<elt_width##_t>(vd + fn * emul, vreg_inx, true) = val; \
     } \
-  } \
+  }
+
+#define VI_LD(stride, offset, elt_width, is_mask_ldst) \
+  VI_LD_BASE(elt_width, is_mask_ldst) \
+  VI_LD_LOOP(stride, offset, elt_width) \
   VECTOR_END;
 
 #define VI_LDST_GET_INDEX(elt_width) \
@@ -1307,12 +1402,14 @@ VI_VX_ULOOP({ \
   } \
   VECTOR_END;
 
-#define VI_ST(stride, offset, elt_width, is_mask_ldst) \
+#define VI_ST_BASE(elt_width, is_mask_ldst) \
   const reg_t nf = insn.v_nf() + 1; \
   VI_CHECK_STORE(elt_width, is_mask_ldst); \
   const reg_t vl = is_mask_ldst ? ((P.VU.vl->read() + 7) / 8) : P.VU.vl->read(); \
   const reg_t baseAddr = RS1; \
-  const reg_t vs3 = insn.rd(); \
+  const reg_t vs3 = insn.rd();
+
+#define VI_ST_LOOP(stride, offset, elt_width) \
   for (reg_t i = 0; i < vl; ++i) { \
     VI_STRIP(i) \
     VI_ELEMENT_SKIP; \
@@ -1322,6 +1419,60 @@ VI_VX_ULOOP({ \
       MMU.store<elt_width##_t>( \
         baseAddr + (stride) + (offset) * sizeof(elt_width##_t), val); \
     } \
+  }
+
+#define VI_ST(stride, offset, elt_width, is_mask_ldst) \
+  VI_ST_BASE(elt_width, is_mask_ldst) \
+  VI_ST_LOOP(stride, offset, elt_width) \
+  VECTOR_END;
+
+// Unmasked unit-stride and whole-register accesses of n elements copy whole
+// pages between memory and the register file with MMU.load_bulk() and
+// MMU.store_bulk().  Elements those stop at (page faults, MMIO, triggers,
+// misalignment) are done one at a time as usual, updating vstart.
+#ifdef WORDS_BIGENDIAN
+#define VI_LDST_BULK_OK(nf) false
+#else
+#define VI_LDST_BULK_OK(nf) ((nf) == 1 && insn.v_vm() == 1)
+#endif
+
+#define VI_LD_BULK(elt_width, vd, n) \
+  elt_width##_t *dst = P.VU.elt_span<elt_width##_t>(vd, n, true); \
+  for (reg_t i = P.VU.vstart->read(); i < (n); ++i) { \
+    i += MMU.load_bulk(baseAddr + i * sizeof(elt_width##_t), (n) - i, dst + i); \
+    if (i == (n)) \
+      break; \
+    P.VU.vstart->write(i); \
+    P.VU.elt<elt_width##_t>(vd, i, true) = \
+      MMU.load<elt_width##_t>(baseAddr + i * sizeof(elt_width##_t)); \
+  }
+
+#define VI_ST_BULK(elt_width, vs3, n) \
+  const elt_width##_t *src = P.VU.elt_span<elt_width##_t>(vs3, n); \
+  for (reg_t i = P.VU.vstart->read(); i < (n); ++i) { \
+    i += MMU.store_bulk(baseAddr + i * sizeof(elt_width##_t), (n) - i, src + i); \
+    if (i == (n)) \
+      break; \
+    P.VU.vstart->write(i); \
+    MMU.store<elt_width##_t>(baseAddr + i * sizeof(elt_width##_t), \
+      P.VU.elt<elt_width##_t>(vs3, i)); \
+  }
+
+#define VI_LD_UNIT_STRIDE(elt_width, is_mask_ldst) \
+  VI_LD_BASE(elt_width, is_mask_ldst) \
+  if (VI_LDST_BULK_OK(nf)) { \
+    VI_LD_BULK(elt_width, vd, vl) \
+  } else { \
+    VI_LD_LOOP(0, (i * nf + fn), elt_width) \
+  } \
+  VECTOR_END;
+
+#define VI_ST_UNIT_STRIDE(elt_width, is_mask_ldst) \
+  VI_ST_BASE(elt_width, is_mask_ldst) \
+  if (VI_LDST_BULK_OK(nf)) { \
+    VI_ST_BULK(elt_width, vs3, vl) \
+  } else { \
+    VI_ST_LOOP(0, (i * nf + fn), elt_width) \
   } \
   VECTOR_END;
 
@@ -1405,10 +1556,14 @@ VI_VX_ULOOP({ \
   require_align(vd, len); \
   const reg_t elt_per_reg = P.VU.vlenb / sizeof(elt_width ## _t); \
   const reg_t size = len * elt_per_reg; \
-  for (reg_t i = P.VU.vstart->read(); i < size; i++) { \
-    P.VU.vstart->write(i); \
-    auto val = MMU.load<elt_width##_t>(baseAddr + i * sizeof(elt_width ## _t)); \
-    P.VU.elt<elt_width ## _t>(vd, i, true) = val; \
+  if (VI_LDST_BULK_OK(1)) { \
+    VI_LD_BULK(elt_width, vd, size) \
+  } else { \
+    for (reg_t i = P.VU.vstart->read(); i < size; i++) { \
+      P.VU.vstart->write(i); \
+      auto val = MMU.load<elt_width##_t>(baseAddr + i * sizeof(elt_width ## _t)); \
+      P.VU.elt<elt_width ## _t>(vd, i, true) = val; \
+    } \
   } \
   VECTOR_END;
 
@@ -1419,10 +1574,14 @@ VI_VX_ULOOP({ \
   const reg_t len = insn.v_nf() + 1; \
   require_align(vs3, len); \
   const reg_t size = len * P.VU.vlenb; \
-  for (reg_t i = P.VU.vstart->read(); i < size; i++) { \
-    P.VU.vstart->write(i); \
-    auto val = P.VU.elt<uint8_t>(vs3, i); \
-    MMU.store<uint8_t>(baseAddr + i, val); \
+  if (VI_LDST_BULK_OK(1)) { \
+    VI_ST_BULK(uint8, vs3, size) \
+  } else { \
+    for (reg_t i = P.VU.vstart->read(); i < size; i++) { \
+      P.VU.vstart->write(i); \
+      auto val = P.VU.elt<uint8_t>(vs3, i); \
+      MMU.store<uint8_t>(baseAddr + i, val); \
+    } \
   } \
   VECTOR_END;
 
@@ -2237,9 +2396,9 @@ default: \
   require_noover(insn.rd(), vd_emul, vs2, 8)
 
 template<typename a_t, typename b_t, typename c_t>
-c_t generic_dot_product(const std::vector<a_t>& a, const std::vector<b_t>& b, c_t c, std::function<c_t(a_t, b_t, c_t)> macc)
+c_t generic_dot_product(const a_t* a, const b_t* b, size_t n, c_t c, std::function<c_t(a_t, b_t, c_t)> macc)
 {
-  for (size_t i = 0; i < a.size(); i++)
+  for (size_t i = 0; i < n; i++)
     c = macc(a[i], b[i], c);
   return c;
 }
@@ -2253,34 +2412,46 @@ c_t generic_dot_product(const std::vector<a_t>& a, const std::vector<b_t>& b, c_
     b[i] = P.VU.elt<b_t>(insn.rs2(), i); \
   } \
   auto& acc = P.VU.elt<c_t>(insn.rd(), 0, true); \
-  acc = dot(a, b, acc); \
+  acc = dot(a.data(), b.data(), a.size(), acc); \
   set_fp_exceptions;
 
 #define ZVLDOT_GENERIC_LOOP(a_t, b_t, c_t, macc) \
-  auto dot = std::bind(generic_dot_product<a_t, b_t, c_t>, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, macc); \
+  auto dot = std::bind(generic_dot_product<a_t, b_t, c_t>, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, macc); \
   ZVLDOT_LOOP(a_t, b_t, c_t, dot)
 
 #define ZVLDOT_SIMPLE_LOOP(a_t, b_t, c_t) \
   auto macc = [](auto a, auto b, auto c) { return c + decltype(c)(a) * decltype(c)(b); }; \
   ZVLDOT_GENERIC_LOOP(a_t, b_t, c_t, macc)
 
+// The dot products run over the VLMAX elements of one register (LMUL = 1),
+// those past vl taking part as zeros.  With vl = VLMAX the operands are
+// read in place from the register file; otherwise they are copied to
+// zero-padded buffers on the stack, sized for the largest VLEN, 4096.
 #define ZVBDOT_LOOP(a_t, b_t, c_t, dot) \
+  reg_t dot_len = P.VU.vlmax, dot_vl = P.VU.vl->read(); \
+  a_t a_pad[4096 / 8 / sizeof(a_t)]; \
+  b_t b_pad[4096 / 8 / sizeof(b_t)]; \
+  const a_t* a = P.VU.elt_span<a_t>(insn.rs1(), dot_len); \
+  if (dot_vl < dot_len) { \
+    std::fill(std::copy_n(a, dot_vl, a_pad), a_pad + dot_len, a_t()); \
+    std::fill(b_pad + dot_vl, b_pad + dot_len, b_t()); \
+    a = a_pad; \
+  } \
   for (reg_t idx = 0; idx < 8; idx++) { \
     reg_t i = ci + idx; \
     VI_LOOP_ELEMENT_SKIP(); \
-    std::vector<a_t> a(P.VU.vlmax, a_t()); \
-    std::vector<b_t> b(P.VU.vlmax, b_t()); \
-    for (reg_t k = 0, vl = P.VU.vl->read(); k < vl; k++) { \
-      a[k] = P.VU.elt<a_t>(insn.rs1(), k); \
-      b[k] = P.VU.elt<b_t>(vs2 + idx, k); \
+    const b_t* b = P.VU.elt_span<b_t>(vs2 + idx, dot_len); \
+    if (dot_vl < dot_len) { \
+      std::copy_n(b, dot_vl, b_pad); \
+      b = b_pad; \
     } \
     auto& acc = P.VU.elt<c_t>(insn.rd(), i, true); \
-    acc = dot(a, b, acc); \
+    acc = dot(a, b, dot_len, acc); \
     set_fp_exceptions; \
   }
 
 #define ZVBDOT_GENERIC_LOOP(a_t, b_t, c_t, macc) \
-  auto dot = std::bind(generic_dot_product<a_t, b_t, c_t>, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, macc); \
+  auto dot = std::bind(generic_dot_product<a_t, b_t, c_t>, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, macc); \
   ZVBDOT_LOOP(a_t, b_t, c_t, dot)
 
 #define ZVBDOT_SIMPLE_LOOP(a_t, b_t, c_t) \
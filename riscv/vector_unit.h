@@ -168,6 +168,20 @@ public:
     return *(EG*)((char*)reg_file + vReg * (VLEN >> 3) + start_byte);
   }
 
+  // elements [0, n) of the register group starting at vReg, which are
+  // contiguous in the register file, for loops that index them directly
+  template<typename T> T* elt_span(reg_t vReg, reg_t n, bool is_write = false) {
+    assert(vsew != 0);
+    reg_t elts_per_reg = (VLEN >> 3) / sizeof(T);
+    assert(elts_per_reg > 0 && vReg * elts_per_reg + n <= NVPR * elts_per_reg);
+    if (is_write) {
+      for (reg_t i = 0; i < n; i += elts_per_reg)
+        log_elt_write_if_needed(vReg + i / elts_per_reg);
+    }
+
+    return (T*)((char*)reg_file + vReg * (VLEN >> 3));
+  }
+
   bool mask_elt(reg_t vReg, reg_t n)
   {
     return (elt<uint8_t>(vReg, n / 8) >> (n % 8)) & 1;
@@ -2,8 +2,6 @@
 #define _RISCV_ZVBDOT_H
 
 #include "bulknormdot.h"
-#include <vector>
-#include <algorithm>
 
 static inline float32_t f32_add_odd(float32_t a, float32_t b)
 {
@@ -27,31 +25,19 @@ static inline float32_t f32_add_odd(float32_t a, float32_t b)
   return res;
 }
 
-static inline float32_t zvfwbdot16bf_dot_acc(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b, float32_t c)
+static inline float32_t zvfwbdot16bf_dot_acc(const uint16_t* a, const uint16_t* b, size_t n, float32_t c)
 {
-  std::vector<bf16_t> fa(a.size());
-  std::transform(a.begin(), a.end(), fa.begin(), [](auto f) { return f; });
-
-  std::vector<bf16_t> fb(b.size());
-  std::transform(b.begin(), b.end(), fb.begin(), [](auto f) { return f; });
-
-  DotConfig cfg(a.size(), int_log2(a.size()) + ((a.size() & (a.size() - 1)) != 0));
-  auto res = bulk_norm_dot_bf16(cfg, &fa[0], &fb[0]);
+  DotConfig cfg(n, int_log2(n) + ((n & (n - 1)) != 0));
+  auto res = bulk_norm_dot<bf16_t, bf16_t>(cfg, a, b);
   softfloat_exceptionFlags |= res.flags;
   return f32_add_odd(f32(res.out), c);
 }
 
 template<typename A, typename B>
-float32_t zvfqbdot8f_dot_acc(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, float32_t c)
+float32_t zvfqbdot8f_dot_acc(const uint8_t* a, const uint8_t* b, size_t n, float32_t c)
 {
-  std::vector<A> fa(a.size());
-  std::transform(a.begin(), a.end(), fa.begin(), [](auto f) { return f; });
-
-  std::vector<B> fb(b.size());
-  std::transform(b.begin(), b.end(), fb.begin(), [](auto f) { return f; });
-
-  DotConfig cfg(a.size(), int_log2(a.size()) + ((a.size() & (a.size() - 1)) != 0));
-  auto res = bulk_norm_dot_ofp8(cfg, &fa[0], &fb[0]);
+  DotConfig cfg(n, int_log2(n) + ((n & (n - 1)) != 0));
+  auto res = bulk_norm_dot<A, B>(cfg, a, b);
   softfloat_exceptionFlags |= res.flags;
   return f32_add_odd(f32(res.out), c);
 }
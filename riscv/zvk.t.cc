@@ -0,0 +1,227 @@
+#include "arith.h"
+#include "vector_unit.h"
+#include "zvkned_ext_macros.h"
+#include "zvk_ext_macros.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Known-answer tests for the table-driven carry-less multiplication, GHASH
+// and AES MixColumns helpers used by the Zvkg and Zvkned instructions,
+// using the vectors of FIPS-197 and of the GCM specification (McGrew and
+// Viega, test case 2).  ZVK_CLMUL64 is also checked against a bit-serial
+// multiplication on random operands.
+
+static int failures = 0;
+
+static void expect(const char* name, const uint8_t* got, const uint8_t* want, size_t len)
+{
+  if (memcmp(got, want, len) == 0)
+    return;
+
+  failures++;
+  fprintf(stderr, "%s: got ", name);
+  for (size_t i = 0; i < len; i++)
+    fprintf(stderr, "%02x", got[i]);
+  fprintf(stderr, ", expected ");
+  for (size_t i = 0; i < len; i++)
+    fprintf(stderr, "%02x", want[i]);
+  fprintf(stderr, "\n");
+}
+
+// An element group as the vector unit holds it: the bytes of a block in
+// memory order, read as little-endian words.
+static EGU32x4_t load_egu32x4(const uint8_t* bytes)
+{
+  EGU32x4_t x;
+  for (size_t i = 0; i < 4; i++)
+    x[i] = bytes[4 * i] | bytes[4 * i + 1] << 8 | bytes[4 * i + 2] << 16 | uint32_t(bytes[4 * i + 3]) << 24;
+  return x;
+}
+
+static void store_egu32x4(uint8_t* bytes, const EGU32x4_t& x)
+{
+  for (size_t i = 0; i < 16; i++)
+    bytes[i] = x[i / 4] >> (8 * (i % 4));
+}
+
+// The bodies of vghsh.vv and vgmul.vv
+static EGU32x4_t vghsh(EGU32x4_t Y, EGU32x4_t X, EGU32x4_t H)
+{
+  EGU32x4_BREV8(H);
+  EGU32x4_t S, Z;
+  EGU32x4_XOR(S, Y, X);
+  EGU32x4_BREV8(S);
+  EGU32x4_GFMUL(Z, S, H);
+  EGU32x4_BREV8(Z);
+  return Z;
+}
+
+static EGU32x4_t vgmul(EGU32x4_t Y, EGU32x4_t H)
+{
+  EGU32x4_BREV8(Y);
+  EGU32x4_BREV8(H);
+  EGU32x4_t Z;
+  EGU32x4_GFMUL(Z, Y, H);
+  EGU32x4_BREV8(Z);
+  return Z;
+}
+
+static void check_clmul()
+{
+  static const struct { uint64_t a, b, lo, hi; } vectors[] = {
+    {0x8000000000000001, 0x8000000000000001, 0x0000000000000001, 0x4000000000000000},
+    {0x0123456789abcdef, 0xfedcba9876543210, 0x40a0789828c810f0, 0x00e038d8688850b0},
+    {0xffffffffffffffff, 0xffffffffffffffff, 0x5555555555555555, 0x5555555555555555},
+  };
+
+  for (auto& v : vectors) {
+    uint64_t lo, hi;
+    ZVK_CLMUL64(v.a, v.b, lo, hi);
+    if (lo != v.lo || hi != v.hi) {
+      failures++;
+      fprintf(stderr, "clmul(%016" PRIx64 ", %016" PRIx64 "): got %016" PRIx64 "%016" PRIx64 ", expected %016" PRIx64 "%016" PRIx64 "\n",
+              v.a, v.b, hi, lo, v.hi, v.lo);
+    }
+  }
+
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < 100000; i++) {
+    uint64_t a = rng(), b = rng(), lo, hi;
+    ZVK_CLMUL64(a, b, lo, hi);
+
+    uint64_t want_lo = 0, want_hi = 0;
+    for (int bit = 0; bit < 64; bit++) {
+      if ((a >> bit) & 1) {
+        want_lo ^= b << bit;
+        want_hi ^= bit ? b >> (64 - bit) : 0;
+      }
+    }
+
+    if (lo != want_lo || hi != want_hi) {
+      if (failures++ < 10)
+        fprintf(stderr, "clmul(%016" PRIx64 ", %016" PRIx64 ") disagrees with the bit-serial product\n", a, b);
+    }
+  }
+}
+
+static void check_ghash()
+{
+  // GCM test case 2: K = 0, P = 0 (one block), IV = 0
+  static const uint8_t H[16] = {
+    0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b, 0x88, 0x4c, 0xfa, 0x59, 0xca, 0x34, 0x2b, 0x2e,
+  };
+  static const uint8_t C[16] = {
+    0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78,
+  };
+  static const uint8_t len_block[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x80,
+  };
+  static const uint8_t X1[16] = {
+    0x5e, 0x2e, 0xc7, 0x46, 0x91, 0x70, 0x62, 0x88, 0x2c, 0x85, 0xb0, 0x68, 0x53, 0x53, 0xde, 0xb7,
+  };
+  static const uint8_t ghash[16] = {
+    0xf3, 0x8c, 0xbb, 0x1a, 0xd6, 0x92, 0x23, 0xdc, 0xc3, 0x45, 0x7a, 0xe5, 0xb6, 0xb0, 0xf8, 0x85,
+  };
+
+  uint8_t out[16];
+  EGU32x4_t h = load_egu32x4(H);
+
+  store_egu32x4(out, vgmul(load_egu32x4(C), h));
+  expect("vgmul(C, H)", out, X1, 16);
+
+  EGU32x4_t y = {};
+  y = vghsh(y, load_egu32x4(C), h);
+  store_egu32x4(out, y);
+  expect("vghsh after the ciphertext block", out, X1, 16);
+  y = vghsh(y, load_egu32x4(len_block), h);
+  store_egu32x4(out, y);
+  expect("vghsh after the length block", out, ghash, 16);
+}
+
+static void expand_key(const uint8_t key[16], EGU8x16_t round_keys[11])
+{
+  uint8_t w[176];
+  memcpy(w, key, 16);
+  uint8_t rcon = 1;
+  for (size_t i = 16; i < sizeof(w); i += 4) {
+    uint8_t t[4] = {w[i - 4], w[i - 3], w[i - 2], w[i - 1]};
+    if (i % 16 == 0) {
+      uint8_t t0 = t[0];
+      t[0] = AES_ENC_SBOX[t[1]] ^ rcon;
+      t[1] = AES_ENC_SBOX[t[2]];
+      t[2] = AES_ENC_SBOX[t[3]];
+      t[3] = AES_ENC_SBOX[t0];
+      rcon = VAES_XTIME(rcon);
+    }
+    for (size_t j = 0; j < 4; j++)
+      w[i + j] = w[i + j - 16] ^ t[j];
+  }
+  for (size_t r = 0; r < 11; r++)
+    memcpy(round_keys[r].data(), &w[16 * r], 16);
+}
+
+static void check_aes()
+{
+  // FIPS-197 section 5.1.3 (via Appendix B, round 1): MixColumns of one column
+  static const uint8_t column[4] = {0xd4, 0xbf, 0x5d, 0x30};
+  static const uint8_t mixed[4] = {0x04, 0x66, 0x81, 0xe5};
+  EGU8x16_t state = {};
+  memcpy(state.data(), column, 4);
+  VAES_MIX_COLUMN(state, 0);
+  expect("MixColumns", state.data(), mixed, 4);
+  VAES_INV_MIX_COLUMN(state, 0);
+  expect("InvMixColumns", state.data(), column, 4);
+
+  // FIPS-197 Appendix C.1, AES-128, as vaesz, vaesem and vaesef and their
+  // inverses compute it
+  static const uint8_t key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  };
+  static const uint8_t plaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+  };
+  static const uint8_t ciphertext[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+  };
+
+  EGU8x16_t round_keys[11];
+  expand_key(key, round_keys);
+
+  memcpy(state.data(), plaintext, 16);
+  EGU8x16_XOREQ(state, round_keys[0]);
+  for (size_t r = 1; r < 10; r++) {
+    VAES_SUB_BYTES(state);
+    VAES_SHIFT_ROWS(state);
+    VAES_MIX_COLUMNS(state);
+    EGU8x16_XOREQ(state, round_keys[r]);
+  }
+  VAES_SUB_BYTES(state);
+  VAES_SHIFT_ROWS(state);
+  EGU8x16_XOREQ(state, round_keys[10]);
+  expect("AES-128 encryption", state.data(), ciphertext, 16);
+
+  EGU8x16_XOREQ(state, round_keys[10]);
+  for (size_t r = 9; r > 0; r--) {
+    VAES_INV_SHIFT_ROWS(state);
+    VAES_INV_SUB_BYTES(state);
+    EGU8x16_XOREQ(state, round_keys[r]);
+    VAES_INV_MIX_COLUMNS(state);
+  }
+  VAES_INV_SHIFT_ROWS(state);
+  VAES_INV_SUB_BYTES(state);
+  EGU8x16_XOREQ(state, round_keys[0]);
+  expect("AES-128 decryption", state.data(), plaintext, 16);
+}
+
+int main()
+{
+  check_clmul();
+  check_ghash();
+  check_aes();
+
+  if (failures)
+    fprintf(stderr, "%d known-answer tests failed\n", failures);
+  return failures != 0;
+}
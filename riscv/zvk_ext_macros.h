@@ -1066,4 +1066,63 @@
     X[1] = dword >> 32; \
   } while (0)
 
+// Computes the 128 bit carryless product of the 64 bit values A and B into
+// HI:LO. A is consumed four bits at a time, using a table of the products
+// of B with every 4 bit value. Declarations are kept free of commas, as
+// this may be expanded inside the BODY of a vector loop macro.
+#define ZVK_CLMUL64(A, B, LO, HI) \
+  do { \
+    const uint64_t clmul_a = (A); \
+    const uint64_t clmul_b = (B); \
+    uint64_t tab_lo[16]; \
+    uint64_t tab_hi[16]; \
+    tab_lo[0] = tab_hi[0] = 0; \
+    for (unsigned n = 1; n < 16; ++n) { \
+      tab_hi[n] = (tab_hi[n >> 1] << 1) | (tab_lo[n >> 1] >> 63); \
+      tab_lo[n] = (tab_lo[n >> 1] << 1) ^ ((n & 1) ? clmul_b : 0); \
+    } \
+    uint64_t clmul_lo = 0; \
+    uint64_t clmul_hi = 0; \
+    for (int shift = 60; shift >= 0; shift -= 4) { \
+      clmul_hi = (clmul_hi << 4) | (clmul_lo >> 60); \
+      clmul_lo <<= 4; \
+      const unsigned n = (clmul_a >> shift) & 0xf; \
+      clmul_lo ^= tab_lo[n]; \
+      clmul_hi ^= tab_hi[n]; \
+    } \
+    (LO) = clmul_lo; \
+    (HI) = clmul_hi; \
+  } while (0)
+
+// Performs "DST = A * B" in GF(2^128) modulo x^128 + x^7 + x^2 + x + 1,
+// where bit i of each (brev8'ed) EGU32x4_t group is the coefficient of x^i.
+// This gives the same result as shifting B left one bit at a time, as in
+// the GHASH algorithm of the spec, but with four 64x64 bit carryless
+// multiplications.
+#define EGU32x4_GFMUL(DST, A, B) \
+  do { \
+    const uint64_t a_lo = (A)[0] | ((uint64_t)(A)[1] << 32); \
+    const uint64_t a_hi = (A)[2] | ((uint64_t)(A)[3] << 32); \
+    const uint64_t b_lo = (B)[0] | ((uint64_t)(B)[1] << 32); \
+    const uint64_t b_hi = (B)[2] | ((uint64_t)(B)[3] << 32); \
+    uint64_t p0, p1, p2, p3, m0, m1, n0, n1; \
+    ZVK_CLMUL64(a_lo, b_lo, p0, p1); \
+    ZVK_CLMUL64(a_hi, b_hi, p2, p3); \
+    ZVK_CLMUL64(a_lo, b_hi, m0, m1); \
+    ZVK_CLMUL64(a_hi, b_lo, n0, n1); \
+    p1 ^= m0 ^ n0; \
+    p2 ^= m1 ^ n1; \
+    /* Fold p3:p2 * x^128 back in as p3:p2 * (x^7 + x^2 + x + 1). The */ \
+    /* bits that shifts out above x^128 are folded once more. */ \
+    const uint64_t carry = (p3 >> 63) ^ (p3 >> 62) ^ (p3 >> 57); \
+    p0 ^= p2 ^ (p2 << 1) ^ (p2 << 2) ^ (p2 << 7) ^ \
+          carry ^ (carry << 1) ^ (carry << 2) ^ (carry << 7); \
+    p1 ^= p3 ^ (p3 << 1) ^ (p3 << 2) ^ (p3 << 7) ^ \
+          (p2 >> 63) ^ (p2 >> 62) ^ (p2 >> 57); \
+    (DST)[0] = (uint32_t)p0; \
+    (DST)[1] = (uint32_t)(p0 >> 32); \
+    (DST)[2] = (uint32_t)p1; \
+    (DST)[3] = (uint32_t)(p1 >> 32); \
+  } while (0)
+
 #endif  // RISCV_ZVK_EXT_MACROS_H_
@@ -229,38 +229,53 @@
    VAES_GFMUL((C), 0xD) ^ \
    VAES_GFMUL((D), 0x9))
 
+// Builds, at compile time, a table of 256 uint32_t whose entry for byte B
+// holds the products (C0 . B, C1 . B, C2 . B, C3 . B), from the least to
+// the most significant byte.
+#define VAES_GFMUL_TABLE(C0, C1, C2, C3) \
+  ([]() constexpr { \
+    std::array<uint32_t, 256> table{}; \
+    for (unsigned b = 0; b < 256; ++b) { \
+      table[b] = (VAES_GFMUL(b, (C0)) & 0xFF) | \
+                 (VAES_GFMUL(b, (C1)) & 0xFF) << 8 | \
+                 (VAES_GFMUL(b, (C2)) & 0xFF) << 16 | \
+                 (VAES_GFMUL(b, (C3)) & 0xFF) << 24; \
+    } \
+    return table; \
+  }())
+
+// Mixes the column COL_IDX of 'STATE' with the matrix whose first column's
+// coefficients are tabulated by TABLE. Byte i of the column contributes
+// TABLE[byte] rotated left by i bytes, as the matrix is circulant.
+#define VAES_MIX_COLUMN_WITH(STATE, COL_IDX, TABLE) \
+  do { \
+    uint8_t *column = &(STATE)[(COL_IDX) * 4]; \
+    const uint32_t mixed = (TABLE)[column[0]] ^ \
+                           ZVK_ROL32((TABLE)[column[1]], 8) ^ \
+                           ZVK_ROL32((TABLE)[column[2]], 16) ^ \
+                           ZVK_ROL32((TABLE)[column[3]], 24); \
+    column[0] = mixed; \
+    column[1] = mixed >> 8; \
+    column[2] = mixed >> 16; \
+    column[3] = mixed >> 24; \
+  } while (0)
+
 // Given a column as a uin32_t (4 Bytes), produces the mixed column
-// as a uin32_t.
+// as a uin32_t. Equivalent to applying VAES_MIX_COLUMN_BYTE to every
+// rotation of the column bytes.
 #define VAES_MIX_COLUMN(STATE, COL_IDX) \
   do { \
-    uint8_t *column = &(STATE)[(COL_IDX) * 4]; \
-    /* Extract the bytes, before we start overwriting them */ \
-    const uint8_t b0 = column[0]; \
-    const uint8_t b1 = column[1]; \
-    const uint8_t b2 = column[2]; \
-    const uint8_t b3 = column[3]; \
-    /* Every iteration rotates the byte indices by 1 */ \
-    column[0] = VAES_MIX_COLUMN_BYTE(b0, b1, b2, b3); \
-    column[1] = VAES_MIX_COLUMN_BYTE(b1, b2, b3, b0); \
-    column[2] = VAES_MIX_COLUMN_BYTE(b2, b3, b0, b1); \
-    column[3] = VAES_MIX_COLUMN_BYTE(b3, b0, b1, b2); \
+    static constexpr auto kVAESMixTable = VAES_GFMUL_TABLE(0x2, 0x1, 0x1, 0x3); \
+    VAES_MIX_COLUMN_WITH((STATE), (COL_IDX), kVAESMixTable); \
   } while (0)
 
 // Given a column as a uin32_t (4 Bytes), produces the inverse
-// mixed column as a uin32_t.
+// mixed column as a uin32_t. Equivalent to applying
+// VAES_INV_MIX_COLUMN_BYTE to every rotation of the column bytes.
 #define VAES_INV_MIX_COLUMN(STATE, COL_IDX) \
   do { \
-    uint8_t *column = &(STATE)[(COL_IDX) * 4]; \
-    /* Extract the bytes, before we start overwriting them */ \
-    const uint8_t b0 = column[0]; \
-    const uint8_t b1 = column[1]; \
-    const uint8_t b2 = column[2]; \
-    const uint8_t b3 = column[3]; \
-    /* Every iteration rotates the byte indices by 1 */ \
-    column[0] = VAES_INV_MIX_COLUMN_BYTE(b0, b1, b2, b3); \
-    column[1] = VAES_INV_MIX_COLUMN_BYTE(b1, b2, b3, b0); \
-    column[2] = VAES_INV_MIX_COLUMN_BYTE(b2, b3, b0, b1); \
-    column[3] = VAES_INV_MIX_COLUMN_BYTE(b3, b0, b1, b2); \
+    static constexpr auto kVAESInvMixTable = VAES_GFMUL_TABLE(0xE, 0x9, 0xD, 0xB); \
+    VAES_MIX_COLUMN_WITH((STATE), (COL_IDX), kVAESInvMixTable); \
   } while (0)
 
 // Implements MixColumns as defined in FIPS-197 5.1.3.
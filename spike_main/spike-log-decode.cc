@@ -0,0 +1,200 @@
+// See LICENSE for license details.
+
+// This little program turns a binary commit log written by
+//   spike --log-commits-binary --log=<file>
+// back into the text printed by --log-commits.  See riscv/commit_log.h for
+// the format.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include "commit_log.h"
+#include "disasm.h"
+
+class reader_t
+{
+public:
+  reader_t(FILE* f) : f(f) {}
+
+  bool at_eof()
+  {
+    int c = getc(f);
+    if (c == EOF)
+      return true;
+    ungetc(c, f);
+    return false;
+  }
+
+  uint8_t u8()
+  {
+    int c = getc(f);
+    if (c == EOF)
+      throw std::runtime_error("log is truncated");
+    return c;
+  }
+
+  void bytes(void* data, size_t len)
+  {
+    if (fread(data, 1, len, f) != len)
+      throw std::runtime_error("log is truncated");
+  }
+
+  uint64_t varint()
+  {
+    uint64_t val = 0;
+    for (int shift = 0; ; shift += 7) {
+      uint8_t byte = u8();
+      val |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return val;
+    }
+  }
+
+  int64_t svarint()
+  {
+    uint64_t val = varint();
+    return int64_t(val >> 1) ^ -int64_t(val & 1);
+  }
+
+private:
+  FILE* f;
+};
+
+static void decode_insn(reader_t& in, FILE* out, uint64_t hart_id, uint64_t& next_pc)
+{
+  static const int flens[] = {0, 16, 32, 64, 128};
+
+  uint8_t mode = in.u8();
+  int priv = mode & 3;
+  int xlen = (mode & 4) ? 64 : 32;
+  int flen = flens[(mode >> 3) & 7];
+  bool has_vec = mode & 0x40;
+
+  uint64_t pc = next_pc + in.svarint();
+  uint64_t bits = 0;
+  in.bytes(&bits, 2);
+  int len = insn_length(bits);
+  in.bytes((uint8_t*)&bits + 2, len - 2);
+  next_pc = pc + len;
+
+  uint64_t vlen = 0, vsew = 0, vl = 0;
+  int64_t vlmul = 0;
+  if (has_vec) {
+    vlen = in.varint();
+    vsew = in.varint();
+    vlmul = in.svarint();
+    vl = in.varint();
+  }
+
+  fprintf(out, "core%4" PRId32 ": ", uint32_t(hart_id));
+  fprintf(out, "%1d ", priv);
+  commit_log_print_value(out, xlen, pc);
+  fprintf(out, " (");
+  commit_log_print_value(out, len * 8, bits);
+  fprintf(out, ")");
+  bool show_vec = false;
+
+  std::vector<uint8_t> data;
+  for (uint64_t n = in.varint(); n > 0; n--) {
+    uint64_t key = in.varint();
+    int rd = key >> 4;
+    char prefix = ' ';
+    int size = 0;
+    bool is_vec = false;
+    bool is_vreg = false;
+    switch (key & 0xf) {
+    case 0: size = xlen; prefix = 'x'; break;
+    case 1: size = flen; prefix = 'f'; break;
+    case 2: size = vlen; prefix = 'v'; is_vreg = true; break;
+    case 3: is_vec = true; break;
+    case 4: size = xlen; prefix = 'c'; break;
+    default: throw std::runtime_error("log is corrupt");
+    }
+
+    if (!show_vec && (is_vreg || is_vec)) {
+      fprintf(out, " e%ld %s%ld l%ld",
+              (long)vsew, vlmul < 0 ? "mf" : "m", (long)(vlmul < 0 ? -vlmul : vlmul), (long)vl);
+      show_vec = true;
+    }
+
+    if (is_vec)
+      continue;
+
+    if (prefix == 'c')
+      fprintf(out, " c%d_%s ", rd, csr_name(rd));
+    else
+      fprintf(out, " %c%-2d ", prefix, rd);
+
+    if (prefix == 'x' || prefix == 'c') {
+      commit_log_print_value(out, size, in.varint());
+    } else {
+      data.resize(size / 8);
+      in.bytes(data.data(), data.size());
+      commit_log_print_value(out, size, data.data());
+    }
+  }
+
+  for (uint64_t n = in.varint(); n > 0; n--) {
+    fprintf(out, " mem ");
+    commit_log_print_value(out, xlen, in.varint());
+  }
+
+  for (uint64_t n = in.varint(); n > 0; n--) {
+    uint64_t addr = in.varint();
+    int size = in.u8();
+    uint64_t val = in.varint();
+    fprintf(out, " mem ");
+    commit_log_print_value(out, xlen, addr);
+    fprintf(out, " ");
+    commit_log_print_value(out, size << 3, val);
+  }
+  fprintf(out, "\n");
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [binary commit log]\n", argv[0]);
+    return 1;
+  }
+
+  FILE* f = argc == 2 ? fopen(argv[1], "rb") : stdin;
+  if (!f) {
+    fprintf(stderr, "Unable to open %s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  try {
+    reader_t in(f);
+    char magic[sizeof(COMMIT_LOG_MAGIC) - 1];
+    uint8_t version[4];
+    in.bytes(magic, sizeof(magic));
+    in.bytes(version, sizeof(version));
+    if (memcmp(magic, COMMIT_LOG_MAGIC, sizeof(magic)) != 0)
+      throw std::runtime_error("not a binary commit log");
+    if ((version[0] | version[1] << 8 | version[2] << 16 | uint32_t(version[3]) << 24) != COMMIT_LOG_VERSION)
+      throw std::runtime_error("unsupported log version");
+
+    std::map<uint64_t, uint64_t> next_pc;
+    uint64_t hart_id = 0;
+    while (!in.at_eof()) {
+      switch (in.u8()) {
+        case COMMIT_LOG_HART:
+          hart_id = in.varint();
+          break;
+        case COMMIT_LOG_INSN:
+          decode_insn(in, stdout, hart_id, next_pc[hart_id]);
+          break;
+        default:
+          throw std::runtime_error("log is corrupt");
+      }
+    }
+  } catch (std::exception& e) {
+    fprintf(stderr, "%s: %s\n", argv[0], e.what());
+    return 1;
+  }
+
+  return 0;
+}
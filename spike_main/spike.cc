@@ -51,13 +51,20 @@ static void help(int exit_code = 1)
   fprintf(stderr, "  --hartids=<a,b,...>   Explicitly specify hartids, default is 0,1,...\n");
   fprintf(stderr, "  --ic=<S>:<W>:<B>      Instantiate a cache model with S sets,\n");
   fprintf(stderr, "  --dc=<S>:<W>:<B>        W ways, and B-byte blocks (with S and\n");
-  fprintf(stderr, "  --l2=<S>:<W>:<B>        B both powers of 2).\n");
+  fprintf(stderr, "  --l2=<S>:<W>:<B>        B both powers of 2).  --l3 sits behind\n");
+  fprintf(stderr, "  --l3=<S>:<W>:<B>        --l2.  Append :<P> to replace blocks by\n");
+  fprintf(stderr, "                          policy P: random (default), lru, plru or\n");
+  fprintf(stderr, "                          rrip; then, for --l2 and --l3, :<I> to\n");
+  fprintf(stderr, "                          hold the blocks of the caches above per I:\n");
+  fprintf(stderr, "                          nine (default), inclusive or exclusive.\n");
   fprintf(stderr, "  --big-endian          Use a big-endian memory system.\n");
   fprintf(stderr, "  --device=<name>       Attach MMIO plugin device from an --extlib library,\n");
   fprintf(stderr, "                          specify --device=<name>,<args> to pass down extra args.\n");
   fprintf(stderr, "  --dtb-discovery       Enable direct device discovery from device tree blob. Requires --dtb and usage of special \"spike_plugin_params\" dts field.\n");
   fprintf(stderr, "  --log-cache-miss      Generate a log of cache miss\n");
   fprintf(stderr, "  --log-commits         Generate a log of commits info\n");
+  fprintf(stderr, "  --log-commits-binary  Like --log-commits, in binary (use with --log;\n");
+  fprintf(stderr, "                          decode with spike-log-decode)\n");
   fprintf(stderr, "  --extension=<name>    Specify RoCC Extension\n");
   fprintf(stderr, "                          This flag can be used multiple times.\n");
   fprintf(stderr, "  --extlib=<name>       Shared library to load\n");
@@ -71,6 +78,9 @@ static void help(int exit_code = 1)
   fprintf(stderr, "  --bootargs=<args>     Provide custom bootargs for kernel [default: %s]\n",
           DEFAULT_KERNEL_BOOTARGS);
   fprintf(stderr, "  --real-time-clint     Increment clint time at real-time rate\n");
+  fprintf(stderr, "  --parallel-harts      Run each hart on its own host thread\n");
+  fprintf(stderr, "  --tlb-entries=<n>     Size of the ASID/VMID-tagged L2 TLB, 0 to disable [default 4096]\n");
+  fprintf(stderr, "  --host-fp             Use the host FPU for scalar F/D arithmetic where exact\n");
   fprintf(stderr, "  --triggers=<n>        Number of supported triggers [default 4]\n");
   fprintf(stderr, "  --dm-progsize=<words> Progsize for the debug module [default 2]\n");
   fprintf(stderr, "  --dm-datacount=<n>    Number of data registers available for the debug module [default 2]\n");
@@ -89,6 +99,12 @@ static void help(int exit_code = 1)
   fprintf(stderr, "  --dm-no-abstractauto  Debug module won't support the abstractauto register\n");
   fprintf(stderr, "  --blocksz=<size>      Cache block size (B) for CMO operations(powers of 2) [default 64]\n");
   fprintf(stderr, "  --instructions=<n>    Stop after n instructions\n");
+  fprintf(stderr, "  --checkpoint-at=<n>   Save a checkpoint after n instructions\n");
+  fprintf(stderr, "  --checkpoint-file=<name> File name for --checkpoint-at [default spike.ckpt]\n");
+  fprintf(stderr, "  --restore=<name>      Restore a checkpoint saved with the same options\n");
+  fprintf(stderr, "\nRead-only segments of the target program are mapped from its file, which\n");
+  fprintf(stderr, "must not be truncated or rewritten in place while Spike runs: the host\n");
+  fprintf(stderr, "kills Spike with SIGBUS if the target then reads a page that has gone.\n");
 
   exit(exit_code);
 }
@@ -335,8 +351,10 @@ int main(int argc, char** argv)
   std::unique_ptr<icache_sim_t> ic;
   std::unique_ptr<dcache_sim_t> dc;
   std::unique_ptr<cache_sim_t> l2;
+  std::unique_ptr<cache_sim_t> l3;
   bool log_cache = false;
   bool log_commits = false;
+  bool log_commits_binary = false;
   const char *log_path = nullptr;
   std::vector<std::function<extension_t*()>> extensions;
   const char* initrd = NULL;
@@ -346,6 +364,9 @@ int main(int argc, char** argv)
   unsigned dmi_rti = 0;
   reg_t blocksz = 64;
   std::optional<unsigned long long> instructions;
+  std::optional<unsigned long long> checkpoint_at;
+  const char* checkpoint_file = "spike.ckpt";
+  const char* restore_file = NULL;
   debug_module_config_t dm_config;
   cfg_arg_t<size_t> nprocs(1);
 
@@ -410,6 +431,7 @@ int main(int argc, char** argv)
   parser.option(0, "ic", 1, [&](const char* s){ic.reset(new icache_sim_t(s));});
   parser.option(0, "dc", 1, [&](const char* s){dc.reset(new dcache_sim_t(s));});
   parser.option(0, "l2", 1, [&](const char* s){l2.reset(cache_sim_t::construct(s, "L2$"));});
+  parser.option(0, "l3", 1, [&](const char* s){l3.reset(cache_sim_t::construct(s, "L3$"));});
   parser.option(0, "big-endian", 0, [&](const char UNUSED *s){cfg.endianness = endianness_big;});
   parser.option(0, "log-cache-miss", 0, [&](const char UNUSED *s){log_cache = true;});
   parser.option(0, "isa", 1, [&](const char* s){cfg.isa = s;});
@@ -426,6 +448,15 @@ int main(int argc, char** argv)
   parser.option(0, "initrd", 1, [&](const char* s){initrd = s;});
   parser.option(0, "bootargs", 1, [&](const char* s){cfg.bootargs = s;});
   parser.option(0, "real-time-clint", 0, [&](const char UNUSED *s){cfg.real_time_clint = true;});
+  parser.option(0, "parallel-harts", 0, [&](const char UNUSED *s){cfg.parallel_harts = true;});
+  parser.option(0, "host-fp", 0, [&](const char UNUSED *s){cfg.host_fp = true;});
+  parser.option(0, "tlb-entries", 1, [&](const char* s){
+    cfg.tlb_entries = strtoull(s, 0, 0);
+    if (cfg.tlb_entries % 4 != 0 || (cfg.tlb_entries & (cfg.tlb_entries - 1)) != 0) {
+      fprintf(stderr, "--tlb-entries must be 0 or a power of 2 no less than 4\n");
+      exit(1);
+    }
+  });
   parser.option(0, "triggers", 1, [&](const char *s){cfg.trigger_count = atoul_safe(s);});
   parser.option(0, "extlib", 1, [&](const char *s){
     void *lib = dlopen(s, RTLD_NOW | RTLD_GLOBAL);
@@ -460,6 +491,8 @@ int main(int argc, char** argv)
       [&](const char UNUSED *s){dm_config.support_abstractauto = false;});
   parser.option(0, "log-commits", 0,
                 [&](const char UNUSED *s){log_commits = true;});
+  parser.option(0, "log-commits-binary", 0,
+                [&](const char UNUSED *s){log_commits = log_commits_binary = true;});
   parser.option(0, "log", 1,
                 [&](const char* s){log_path = s;});
   FILE *cmd_file = NULL;
@@ -483,6 +516,11 @@ int main(int argc, char** argv)
   parser.option(0, "instructions", 1, [&](const char* s){
     instructions = strtoull(s, 0, 0);
   });
+  parser.option(0, "checkpoint-at", 1, [&](const char* s){
+    checkpoint_at = strtoull(s, 0, 0);
+  });
+  parser.option(0, "checkpoint-file", 1, [&](const char* s){checkpoint_file = s;});
+  parser.option(0, "restore", 1, [&](const char* s){restore_file = s;});
 
   auto argv1 = parser.parse(argv);
   std::vector<std::string> htif_args(argv1, (const char*const*)argv + argc);
@@ -548,12 +586,32 @@ int main(int argc, char** argv)
    if (dtb_enabled==false) {    std::cerr << "--dtb-discovery option is not compatible with --disable-dtb"<<std::endl;  exit(1);}
   }
 
+  // The cache models are shared by all harts and are not thread-safe.
+  if (cfg.parallel_harts && (ic || dc || l2 || l3)) {
+    std::cerr << "--parallel-harts option is not compatible with --ic, --dc, --l2 or --l3." << std::endl;
+    exit(1);
+  }
+
+  // The binary log would otherwise go to stderr, or be mixed with -l output.
+  if (log_commits_binary && (!log_path || log)) {
+    std::cerr << "--log-commits-binary option requires --log and is not compatible with -l." << std::endl;
+    exit(1);
+  }
+
 
   sim_t s(&cfg, halted,
       mems, plugin_device_factories, dtb_discovery, htif_args, dm_config, log_path, dtb_enabled, dtb_file,
       socket,
       cmd_file,
       instructions);
+
+  // A checkpoint holds no state of the HTIF service thread, so a request it
+  // is working on would be lost, or half-applied to the saved memory.
+  if (s.is_async() && (checkpoint_at || restore_file)) {
+    std::cerr << "+async-htif option is not compatible with --checkpoint-at or --restore." << std::endl;
+    exit(1);
+  }
+
   std::unique_ptr<remote_bitbang_t> remote_bitbang((remote_bitbang_t *) NULL);
   std::unique_ptr<jtag_dtm_t> jtag_dtm(
       new jtag_dtm_t(&s.debug_module, dmi_rti));
@@ -567,8 +625,10 @@ int main(int argc, char** argv)
     return 0;
   }
 
-  if (ic && l2) ic->set_miss_handler(&*l2);
-  if (dc && l2) dc->set_miss_handler(&*l2);
+  if (l2 && l3) l2->set_miss_handler(&*l3);
+  cache_sim_t* l1_miss_handler = l2 ? &*l2 : l3 ? &*l3 : nullptr;
+  if (ic && l1_miss_handler) ic->set_miss_handler(l1_miss_handler);
+  if (dc && l1_miss_handler) dc->set_miss_handler(l1_miss_handler);
   if (ic) ic->set_log(log_cache);
   if (dc) dc->set_log(log_cache);
   for (size_t i = 0; i < cfg.nprocs(); i++)
@@ -580,8 +640,12 @@ int main(int argc, char** argv)
   }
 
   s.set_debug(debug);
-  s.configure_log(log, log_commits);
+  s.configure_log(log, log_commits, log_commits_binary);
   s.set_histogram(histogram);
+  if (checkpoint_at)
+    s.set_checkpoint(*checkpoint_at, checkpoint_file);
+  if (restore_file)
+    s.set_restore(restore_file);
 
   auto return_code = s.run();
 